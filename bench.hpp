@@ -0,0 +1,1370 @@
+/** @file bench.hpp
+    The driver of `h5bench` and of its aliases: parameters, file setup, buffer preparation,
+    aggregation, timing, read-back and reporting, shared by all patterns of `patterns.hpp`
+*/
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <mpiwrap/mpiwrap.hpp>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "h5_types.hpp"
+#include "checksum.hpp"
+#include "sweep.hpp"
+#include "results.hpp"
+#include "parse_and_bcast.hpp"
+#include "node_aggregator.hpp"
+#include "patterns.hpp"
+#include "replay.hpp"
+#include "footprint.hpp"
+#include "drivers.hpp"
+#include "striping.hpp"
+
+namespace bench {
+    namespace po=program_options;
+    namespace mpi=mpiwrap;
+
+    /// The parameters of one sweep point
+    struct options {
+        std::string pattern;
+        std::string read_pattern;    ///< "none" if the data are not read back
+        std::string file_name;
+        std::string data_name;
+        bool do_collective;
+        std::string type_name;
+        bool swap_order;
+        std::vector<hsize_t> chunk;  ///< empty for the contiguous layout
+        std::string hints;           ///< MPI-IO hints, as `key=value:key=value`
+        std::string aggregate;
+        int nthreads;
+        std::size_t stage;
+        std::size_t read_mb;
+        std::string point;
+        std::string results_file;
+        std::string results_format;
+        std::string trace_file;          ///< empty if the HDF5 calls are not traced
+        std::size_t trace_events;
+        std::string record_file;         ///< empty if the I/O is not recorded for `h5replay`
+        std::string storage;             ///< "disk", "core" (a private in-memory file per process) or "tmpfs"
+        std::size_t sieve_bytes;         ///< the data-sieve buffer, `H5D_CHUNK_CACHE_NBYTES_DEFAULT` for the HDF5 default
+        std::size_t chunk_slots;         ///< the chunk cache, as for `H5Pset_chunk_cache()` (the HDF5 defaults by default)
+        std::size_t chunk_bytes;
+        double chunk_w0;
+        drivers::config vfd;             ///< the parallel file driver
+        std::size_t stripe_bytes;        ///< the stripe size of the file system; 0 if unknown
+        bool stripe_align;               ///< whether the accesses are aligned to the stripes
+        std::size_t stripe_count;        ///< the number of stripe targets to simulate; 0 if not simulated
+        std::size_t align_threshold;     ///< the objects of the file from this size on are aligned to stripes
+        std::vector<std::string> keys;   ///< all parameters of the point, from which the patterns are made
+        std::vector<std::string> values;
+
+        /// Visits the fields, to broadcast the parameters in one message
+        template <typename A>
+        void serialize(A& ar)
+        {
+            ar & pattern
+               & read_pattern
+               & file_name
+               & data_name
+               & do_collective
+               & type_name
+               & swap_order
+               & chunk
+               & hints
+               & aggregate
+               & nthreads
+               & stage
+               & read_mb
+               & point
+               & results_file
+               & results_format
+               & trace_file
+               & trace_events
+               & record_file
+               & storage
+               & sieve_bytes
+               & chunk_slots
+               & chunk_bytes
+               & chunk_w0
+               & vfd
+               & stripe_bytes
+               & stripe_align
+               & stripe_count
+               & align_threshold
+               & keys
+               & values;
+        }
+
+        /// The parameters of the point, as given on the command line
+        po::params_map params() const
+        {
+            po::params_map par;
+            for (std::size_t i=0; i<keys.size(); ++i) par.set(keys[i], values[i]);
+            return par;
+        }
+    };
+
+
+    /// Maps the parameters of an alias program to those of `h5bench`; false (after printing the reason) if they are invalid
+    typedef bool (*translator)(po::params_map& par);
+
+
+    /// Finds out the size of the element type chosen at run time
+    struct type_size {
+        std::size_t size;
+
+        template <typename T>
+        void run() { size=sizeof(T); }
+    };
+
+
+    /// Splits the MPI-IO hints `key=value:key=value` into pairs; returns false if they are malformed
+    inline bool parse_hints(const std::string& hints, std::vector< std::pair<std::string,std::string> >& pairs)
+    {
+        std::string::size_type pos=0;
+        while (pos<hints.size()) {
+            const auto colon=hints.find(':', pos);
+            const std::string item=hints.substr(pos, colon==std::string::npos? std::string::npos : colon-pos);
+            const auto eq=item.find('=');
+            if (eq==std::string::npos || eq==0) return false;
+            pairs.push_back({item.substr(0, eq), item.substr(eq+1)});
+            if (colon==std::string::npos) break;
+            pos=colon+1;
+        }
+        return true;
+    }
+
+
+    /// The MPI info object holding the hints `key=value:key=value`, to be freed by the caller; `MPI_INFO_NULL` if there are none
+    inline MPI_Info make_info(const std::string& hints)
+    {
+        std::vector< std::pair<std::string,std::string> > pairs;
+        parse_hints(hints, pairs);
+        if (pairs.empty()) return MPI_INFO_NULL;
+        MPI_Info info;
+        MPI_Info_create(&info);
+        for (const auto& kv: pairs) MPI_Info_set(info, kv.first.c_str(), kv.second.c_str());
+        return info;
+    }
+
+
+    /// The name of the dataset `dset` out of `ndsets`
+    inline std::string dataset_name(const std::string& name, std::size_t dset, std::size_t ndsets)
+    {
+        return ndsets>1? name+std::to_string(dset) : name;
+    }
+
+
+    /// A size parameter as given: `default` for the HDF5 default
+    inline std::string size_text(std::size_t size)
+    {
+        return size==H5D_CHUNK_CACHE_NBYTES_DEFAULT? "default" : std::to_string(size);
+    }
+
+    /// Reads the parameter `key`, a number or `default` (the HDF5 default, `library_default`)
+    template <typename T>
+    inline po::optional<T> get_or_default(const po::params_map& par, const std::string& key, T library_default)
+    {
+        const auto maybe_text=par.get_or(key, "default");
+        if (maybe_text && *maybe_text=="default") return po::make_optional(library_default);
+        return par.get<T>(key);
+    }
+
+
+    /// Adds the parameters to a results record
+    inline void add_params(results::record& rec, const options& par, const patterns::pattern& pat)
+    {
+        rec.add("pattern", par.pattern);
+        pat.add_params(rec);
+        std::vector<std::string> chunk;
+        for (auto c: par.chunk) chunk.push_back(std::to_string(c));
+        rec .add("file", par.file_name)
+           .add("name", par.data_name)
+           .add("collective", par.do_collective)
+           .add("read", par.read_pattern)
+           .add("readbuf", par.read_mb)
+           .add("chunk", chunk.empty()? "none" : results::join(chunk, "x"))
+           .add("requested_hints", par.hints)
+           .add("aggregate", par.aggregate)
+           .add("threads", par.nthreads)
+           .add("stage", par.stage)
+           .add("type", par.type_name)
+           .add("swap", par.swap_order)
+           .add("storage", par.storage)
+           .add("sieve", size_text(par.sieve_bytes))
+           .add("chunk_cache", size_text(par.chunk_bytes))
+           .add("chunk_slots", size_text(par.chunk_slots))
+           .add("chunk_w0", par.chunk_w0<0? std::string("default") : std::to_string(par.chunk_w0))
+           .add("vfd", par.vfd.name)
+           .add("subfiles", par.vfd.subfiles)
+           .add("subfile_stripe", par.vfd.stripe_size)
+           .add("stripe", par.stripe_bytes)
+           .add("align", par.stripe_align)
+           .add("stripe_count", par.stripe_count);
+    }
+
+
+    /// Checks and converts the parameters of one sweep point; prints the reason if they are invalid
+    inline po::optional<options> get_options(const po::params_map& par, int nprocs, const std::string& default_pattern)
+    {
+        const po::optional<options> empty;
+        auto maybe_pattern = default_pattern.empty()? par.get<std::string>("pattern") : par.get_or("pattern", default_pattern);
+        if (!maybe_pattern || !patterns::find(*maybe_pattern)) {
+            std::cerr << "pattern parameter is missing or invalid\n";
+            return empty;
+        }
+
+        auto maybe_collective = par.get<bool>("collective");
+        if (!maybe_collective) {
+            std::cerr << "collective parameter is missing or invalid\n";
+            return empty;
+        }
+
+        auto maybe_file = par.get<std::string>("file");
+        if (!maybe_file) {
+            std::cerr << "file parameter is missing or invalid\n";
+            return empty;
+        }
+
+        auto maybe_name = par.get_or("name", "double_set");
+        if (!maybe_name) {
+            std::cerr << "name parameter is missing or invalid\n";
+            return empty;
+        }
+
+        auto maybe_read = par.get_or("read", "none");
+        if (!maybe_read || (*maybe_read!="none" && !patterns::find(*maybe_read))) {
+            std::cerr << "read parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_readbuf = par.get_or<std::size_t>("readbuf", 64);
+        if (!maybe_readbuf || *maybe_readbuf<1) {
+            std::cerr << "readbuf parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_chunk = par.get_or("chunk", "");
+        const auto chunk= maybe_chunk? patterns::parse_extents(*maybe_chunk) : std::vector<hsize_t>();
+        if (!maybe_chunk || (!maybe_chunk->empty() && chunk.empty())) {
+            std::cerr << "chunk parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_hints = par.get_or("hints", "");
+        std::vector< std::pair<std::string,std::string> > hint_pairs;
+        if (!maybe_hints || !parse_hints(*maybe_hints, hint_pairs)) {
+            std::cerr << "hints parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_aggregate = par.get_or("aggregate", "none");
+        if (!maybe_aggregate || (*maybe_aggregate!="none" && *maybe_aggregate!="node")) {
+            std::cerr << "aggregate parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_threads = par.get_or("threads", 1);
+        if (!maybe_threads || *maybe_threads<1) {
+            std::cerr << "threads parameter is invalid\n";
+            return empty;
+        }
+#ifndef _OPENMP
+        if (*maybe_threads>1) {
+            std::cerr << "threads parameter is invalid: built without OpenMP, the buffers are prepared by one thread\n";
+            return empty;
+        }
+#endif
+
+        auto maybe_stage = par.get_or<std::size_t>("stage", 0);
+        if (!maybe_stage) {
+            std::cerr << "stage parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_type = par.get_or("type", "double");
+        if (!maybe_type || !h5::is_known_type(*maybe_type)) {
+            std::cerr << "type parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_swap = par.get_or("swap", false);
+        if (!maybe_swap) {
+            std::cerr << "swap parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_results = par.get_or("results", "");
+        if (!maybe_results) {
+            std::cerr << "results parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_format = par.get_or("format", "csv");
+        if (!maybe_format || (*maybe_format!="csv" && *maybe_format!="json")) {
+            std::cerr << "format parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_trace = par.get_or("trace", "");
+        if (!maybe_trace) {
+            std::cerr << "trace parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_tracebuf = par.get_or<std::size_t>("tracebuf", 65536);
+        if (!maybe_tracebuf || *maybe_tracebuf<1) {
+            std::cerr << "tracebuf parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_record = par.get_or("record", "");
+        if (!maybe_record) {
+            std::cerr << "record parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_storage = par.get_or("storage", "disk");
+        if (!maybe_storage || (*maybe_storage!="disk" && *maybe_storage!="core" && *maybe_storage!="tmpfs")) {
+            std::cerr << "storage parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_tmpdir = par.get_or("tmpdir", "/dev/shm");
+        if (!maybe_tmpdir || maybe_tmpdir->empty()) {
+            std::cerr << "tmpdir parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_sieve = get_or_default<std::size_t>(par, "sieve", H5D_CHUNK_CACHE_NBYTES_DEFAULT);
+        if (!maybe_sieve) {
+            std::cerr << "sieve parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_chunk_cache = get_or_default<std::size_t>(par, "chunk_cache", H5D_CHUNK_CACHE_NBYTES_DEFAULT);
+        if (!maybe_chunk_cache) {
+            std::cerr << "chunk_cache parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_chunk_slots = get_or_default<std::size_t>(par, "chunk_slots", H5D_CHUNK_CACHE_NSLOTS_DEFAULT);
+        if (!maybe_chunk_slots || *maybe_chunk_slots<1) {
+            std::cerr << "chunk_slots parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_chunk_w0 = get_or_default<double>(par, "chunk_w0", H5D_CHUNK_CACHE_W0_DEFAULT);
+        if (!maybe_chunk_w0 || (*maybe_chunk_w0!=H5D_CHUNK_CACHE_W0_DEFAULT && (*maybe_chunk_w0<0 || *maybe_chunk_w0>1))) {
+            std::cerr << "chunk_w0 parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_vfd = drivers::get_config(par);
+        if (!maybe_vfd) return empty;
+
+        auto maybe_stripe = par.get_or<std::size_t>("stripe", 0);
+        if (!maybe_stripe) {
+            std::cerr << "stripe parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_align = par.get_or("align", true);
+        if (!maybe_align) {
+            std::cerr << "align parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_stripe_count = par.get_or<std::size_t>("stripe_count", 0);
+        if (!maybe_stripe_count) {
+            std::cerr << "stripe_count parameter is invalid\n";
+            return empty;
+        }
+
+        // ROMIO does the data sieving of the MPI-IO driver: size its buffers too, unless given as hints
+        std::string hints=*maybe_hints;
+        if (*maybe_sieve!=H5D_CHUNK_CACHE_NBYTES_DEFAULT) {
+            for (const char* key: {"ind_wr_buffer_size", "ind_rd_buffer_size"}) {
+                bool given=false;
+                for (const auto& h: hint_pairs) given= given || h.first==key;
+                if (!given) hints+=(hints.empty()? "" : ":")+std::string(key)+"="+std::to_string(*maybe_sieve);
+            }
+        }
+
+        // and the striping of a new file, on Lustre
+        const std::pair<const char*, std::size_t> striping_hints[]={
+            {"striping_unit", *maybe_stripe}, {"striping_factor", *maybe_stripe>0? *maybe_stripe_count : 0}
+        };
+        for (const auto& sh: striping_hints) {
+            bool skip= sh.second==0;
+            for (const auto& h: hint_pairs) skip= skip || h.first==sh.first;
+            if (!skip) hints+=(hints.empty()? "" : ":")+std::string(sh.first)+"="+std::to_string(sh.second);
+        }
+
+        // the patterns check their own parameters
+        type_size tsize={0};
+        h5::dispatch_type(*maybe_type, tsize);
+        const auto pat=patterns::create(*maybe_pattern, par, nprocs, tsize.size);
+        if (!pat) return empty;
+        const auto dims=pat->dims();
+        for (auto d: dims) {
+            if (d<1) {
+                std::cerr << "The dataset is empty\n";
+                return empty;
+            }
+        }
+        if (*maybe_aggregate=="node" && pat->ndatasets()>1) {
+            std::cerr << "aggregate=node needs a pattern with a single dataset\n";
+            return empty;
+        }
+        if (*maybe_aggregate=="node") {
+            // the node buffer holds the selected elements only, so a buffer layout would be ignored
+            std::vector<hsize_t> mem_dims;
+            auto mem_sel=patterns::selection::none(1);
+            for (int rank=0; rank<nprocs; ++rank) {
+                if (pat->buffer_layout(rank, 0, mem_dims, mem_sel)) {
+                    std::cerr << "aggregate=node cannot keep the buffer layout of the pattern " << *maybe_pattern
+                              << " (e.g., ghost cells)\n";
+                    return empty;
+                }
+            }
+            // the node buffer holds each element once, in the file order
+            if (patterns::overlapping(*pat, nprocs)) {
+                std::cerr << "aggregate=node needs the processes to access distinct elements"
+                          << " (the selections of the pattern " << *maybe_pattern << " overlap)\n";
+                return empty;
+            }
+        }
+        if (*maybe_read!="none") {
+            const auto read_pat=patterns::create(*maybe_read, par, nprocs, tsize.size);
+            if (!read_pat) return empty;
+            if (read_pat->dims()!=dims || read_pat->ndatasets()!=pat->ndatasets()) {
+                std::cerr << "The read pattern " << *maybe_read << " does not match the datasets of the pattern "
+                          << *maybe_pattern << "\n";
+                return empty;
+            }
+        }
+        if (*maybe_storage=="core" && *maybe_aggregate!="none") {
+            std::cerr << "storage=core needs aggregate=none: each process writes its own file\n";
+            return empty;
+        }
+        if (*maybe_storage=="core" && maybe_vfd->name!="mpio") {
+            std::cerr << "storage=core replaces the parallel file driver: it needs vfd=mpio\n";
+            return empty;
+        }
+        if (*maybe_storage=="core" && *maybe_read!="none" && *maybe_read!=*maybe_pattern) {
+            std::cerr << "storage=core can only read back in the write pattern: each process reads its own file\n";
+            return empty;
+        }
+        hsize_t dset_bytes=tsize.size;
+        for (auto d: dims) dset_bytes*=d;
+        if (!chunk.empty() && chunk.size()!=dims.size()) {
+            std::cerr << "chunk parameter must have " << dims.size() << " extents for the pattern " << *maybe_pattern << "\n";
+            return empty;
+        }
+
+        options opt = {
+            *maybe_pattern,
+            *maybe_read,
+            *maybe_file,
+            *maybe_name,
+            *maybe_collective,
+            *maybe_type,
+            *maybe_swap,
+            chunk,
+            hints,
+            *maybe_aggregate,
+            *maybe_threads,
+            *maybe_stage,
+            *maybe_readbuf,
+            std::string(),
+            *maybe_results,
+            *maybe_format,
+            *maybe_trace,
+            *maybe_tracebuf,
+            *maybe_record,
+            *maybe_storage,
+            *maybe_sieve,
+            *maybe_chunk_slots,
+            *maybe_chunk_cache,
+            *maybe_chunk_w0,
+            *maybe_vfd,
+            *maybe_stripe,
+            *maybe_align,
+            *maybe_stripe_count,
+            std::min<std::size_t>(*maybe_stripe, dset_bytes),
+            {},
+            {}
+        };
+        for (std::size_t d=0; d<opt.chunk.size(); ++d) opt.chunk[d]=std::min(opt.chunk[d], dims[d]);
+        if (opt.storage=="tmpfs") {
+            const auto slash=opt.file_name.rfind('/');
+            opt.file_name=*maybe_tmpdir+"/"+opt.file_name.substr(slash==std::string::npos? 0 : slash+1);
+        }
+        for (const auto& key: par.keys()) {
+            auto maybe_value=par.get<std::string>(key);
+            if (!maybe_value) continue;
+            opt.keys.push_back(key);
+            opt.values.push_back(*maybe_value);
+        }
+        return po::make_optional(opt);
+    }
+
+
+    /// Parses the parameters and expands the sweeps into the parameters of all points
+    inline po::optional< std::vector<options> > parse_points(int argc, const char* const* argv, int nprocs,
+                                                             const std::string& default_pattern, translator translate)
+    {
+        const po::optional< std::vector<options> > empty;
+        std::vector<options> points;
+        auto par = po::parse(argc, argv);
+        if (!par || argc<2) {
+            std::cerr << "Usage: " << argv[0]
+                      << (default_pattern.empty()? " pattern=<name>" : " [pattern=<name>]")
+                      << " <pattern parameters> file=<file_name> [name=<dataset_name>] collective=<yes|no>"
+                      << " [read=<none|pattern>] [readbuf=<read_buffer_MB>]"
+                      << " [chunk=<extent>x<extent>...] [hints=<key>=<value>:<key>=<value>...]"
+                      << " [aggregate=<none|node>] [threads=<number>] [stage=<padding_values>]"
+                      << " [type=<double|float|int32|int64|particle>] [swap=<yes|no>]"
+                      << " [files=<recycle|fresh>]"
+                      << " [results=<file|->] [format=<csv|json>]"
+                      << " [trace=<file.json>] [tracebuf=<calls_per_process>] [record=<replay_trace>]"
+                      << " [storage=<disk|core|tmpfs>] [tmpdir=<tmpfs_directory>]"
+                      << " [sieve=<bytes|default>] [chunk_cache=<bytes|default>] [chunk_slots=<number|default>]"
+                      << " [chunk_w0=<0..1|default>]"
+                      << " [vfd=<mpio|subfiling>] [subfiles=<number>] [subfile_stripe=<bytes>]"
+                      << " [stripe=<bytes>] [align=<yes|no>] [stripe_count=<targets>]\n"
+                      << "Patterns" << (default_pattern.empty()? "" : " (default: "+default_pattern+")") << ":\n";
+            for (const auto& e: patterns::registry()) {
+                std::cerr << "  " << e.name << " " << e.usage << "\n      " << e.help << "\n";
+            }
+            std::cerr << "Numeric values may be swept as lists and ranges, e.g. gap=0,8,4096 or blocksize=1k..64M:x2"
+                      << std::endl;
+            return empty;
+        }
+
+        const auto swept=po::swept_keys(*par, sweep::verbatim_keys());
+        auto sweep_points=po::expand_sweeps(*par, sweep::verbatim_keys());
+        for (std::size_t i=0; i<sweep_points.size(); ++i) {
+            if (translate && !translate(sweep_points[i])) return empty;
+            auto maybe_files = sweep_points[i].get_or("files", "recycle");
+            if (!maybe_files || (*maybe_files!="recycle" && *maybe_files!="fresh")) {
+                std::cerr << "files parameter is invalid\n";
+                return empty;
+            }
+
+            auto maybe_opt = get_options(sweep_points[i], nprocs, default_pattern);
+            if (!maybe_opt) return empty;
+            options opt = *maybe_opt;
+            opt.point = sweep::point_label(sweep_points[i], swept);
+            if (*maybe_files=="fresh" && sweep_points.size()>1) {
+                opt.file_name = sweep::point_file_name(opt.file_name, i);
+            }
+            points.push_back(opt);
+        }
+
+        return po::make_optional(points);
+    }
+
+
+    /// A file access property list for parallel I/O over `comm`, with the requested driver and MPI-IO hints
+    /**
+       With `storage=core`, the file is instead private to this process and kept in memory
+       (opened from the copy `image` of its content, if given), so that the I/O measures
+       the HDF5 library alone.
+    */
+    inline hid_t file_access(const mpi::communicator& comm, const options& par, std::vector<char>* image=nullptr)
+    {
+        hid_t fapl=H5Pcreate(H5P_FILE_ACCESS);
+        if (fapl>=0 && par.stripe_bytes>0 && par.stripe_align) {
+            // the datasets (but not the smaller metadata) start on stripe boundaries
+            h5::check_error(H5Pset_alignment(fapl, par.align_threshold, par.stripe_bytes));
+        }
+        if (fapl>=0 && par.sieve_bytes!=H5D_CHUNK_CACHE_NBYTES_DEFAULT) {
+            h5::check_error(H5Pset_sieve_buf_size(fapl, par.sieve_bytes));
+        }
+        if (fapl>=0 && par.storage=="core") {
+            h5::check_error(H5Pset_fapl_core(fapl, 16*1024*1024, false));
+            if (image && !image->empty()) h5::check_error(H5Pset_file_image(fapl, image->data(), image->size()));
+            return fapl;
+        }
+        MPI_Info info=make_info(par.hints);
+        const herr_t status= fapl>=0? drivers::set(fapl, par.vfd, comm, info) : 0; // the property list keeps a copy of the hints
+        if (info!=MPI_INFO_NULL) MPI_Info_free(&info);
+        h5::check_error(status);
+        return fapl;
+    }
+
+    /// A dataset creation property list with the requested layout
+    inline hid_t dataset_create(const options& par)
+    {
+        hid_t dcpl=H5Pcreate(H5P_DATASET_CREATE);
+        if (dcpl>=0 && !par.chunk.empty()) h5::check_error(H5Pset_chunk(dcpl, par.chunk.size(), par.chunk.data()));
+        return dcpl;
+    }
+
+    /// A dataset access property list with the requested chunk cache
+    inline hid_t dataset_access(const options& par)
+    {
+        hid_t dapl=H5Pcreate(H5P_DATASET_ACCESS);
+        if (dapl>=0) h5::check_error(H5Pset_chunk_cache(dapl, par.chunk_slots, par.chunk_bytes, par.chunk_w0));
+        return dapl;
+    }
+
+    /// A dataset transfer property list with the requested I/O mode
+    inline hid_t transfer(const options& par)
+    {
+        hid_t xfer=H5Pcreate(H5P_DATASET_XFER);
+        if (xfer>=0 && par.storage!="core") H5Pset_dxpl_mpio(xfer, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT);
+        return xfer;
+    }
+
+    /// The I/O mode actually used by a transfer with `xfer`
+    inline std::string io_mode(const options& par, hid_t xfer)
+    {
+        return par.storage=="core"? "in memory (core driver, a file per process)" : h5::actual_io_mode(xfer);
+    }
+
+    /// A 1D memory space of `n` elements (with nothing selected if `n` is zero)
+    inline hid_t memory_space(hsize_t n)
+    {
+        const hsize_t size=std::max<hsize_t>(n, 1);
+        hid_t space=H5Screate_simple(1, &size, nullptr);
+        if (space>=0 && n==0) h5::check_error(H5Sselect_none(space));
+        return space;
+    }
+
+
+    /// A part of a run, prepared by one thread
+    struct task {
+        std::size_t run;
+        hsize_t first;   ///< offset in the run
+        hsize_t length;
+        hsize_t local;   ///< offset in the staging array
+    };
+
+    /// Cuts the runs into tasks of bounded size, so that long runs are shared by the threads
+    /**
+       `local_size` is set to the size of the staging array, which holds the runs
+       separated by `stage` padding elements.
+    */
+    inline std::vector<task> make_tasks(const std::vector<patterns::run>& runs, std::size_t stage, hsize_t& local_size)
+    {
+        const hsize_t max_length=hsize_t(1)<<15;
+        std::vector<task> tasks;
+        local_size=0;
+        for (std::size_t k=0; k<runs.size(); ++k) {
+            for (hsize_t i=0; i<runs[k].length; i+=max_length) {
+                tasks.push_back({k, i, std::min(max_length, runs[k].length-i), local_size+i});
+            }
+            local_size+=runs[k].length+stage;
+        }
+        return tasks;
+    }
+
+    /// Generates the values of the runs into the buffer `buf`, on `nthreads` threads
+    /**
+       The element at the position `pos` gets the value `make(pos+1)`, so that the elements
+       read back can be checked whatever the read pattern is, and a zero stands for an element
+       that was never written. With `stage>0`, the runs are first generated into the staging
+       array `local`, separated by `stage` padding elements (as ghost cells or gaps of an
+       application's own layout), and then copied into the buffer.
+    */
+    template <typename T>
+    void generate(T* buf, const std::vector<patterns::run>& runs, const std::vector<task>& tasks,
+                  std::vector<T>& local, int nthreads, std::size_t stage)
+    {
+        typedef h5::type_traits<T> traits;
+        const std::size_t ntasks=tasks.size();
+#ifndef _OPENMP
+        (void)nthreads;  // `get_options()` allows one thread only
+#endif
+        if (stage==0) {
+#ifdef _OPENMP
+            #pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+            for (std::size_t t=0; t<ntasks; ++t) {
+                const task& tk=tasks[t];
+                const patterns::run& r=runs[tk.run];
+                T* dst=buf+r.buf+tk.first;
+                for (hsize_t i=0; i<tk.length; ++i) dst[i]=traits::make(r.pos+tk.first+i+1);
+            }
+            return;
+        }
+
+        const T pad=traits::make(0);
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (std::size_t t=0; t<ntasks; ++t) {
+            const task& tk=tasks[t];
+            const patterns::run& r=runs[tk.run];
+            T* dst=&local[tk.local];
+            for (hsize_t i=0; i<tk.length; ++i) dst[i]=traits::make(r.pos+tk.first+i+1);
+            if (tk.first+tk.length==r.length) std::fill(dst+tk.length, dst+tk.length+stage, pad);
+        }
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (std::size_t t=0; t<ntasks; ++t) {
+            const task& tk=tasks[t];
+            std::copy_n(&local[tk.local], tk.length, buf+runs[tk.run].buf+tk.first);
+        }
+    }
+
+
+    /// The runs of the process `members[me]`, placed in the node buffer which the node's leader writes
+    /**
+       The leader writes the node buffer to the union of the selections of the node's processes,
+       whose elements HDF5 takes in the file order; so the runs of all processes of the node
+       are placed one after another in the file order. `total` is set to the number of
+       elements of the node.
+    */
+    inline std::vector<patterns::run> node_runs(const patterns::pattern& pat, const std::vector<int>& members,
+                                                std::size_t me, hsize_t& total)
+    {
+        struct tagged_run {
+            hsize_t pos;
+            hsize_t length;
+            std::size_t member;
+            std::size_t index;
+        };
+        const auto dims=pat.dims();
+        std::vector<patterns::run> mine;
+        std::vector<tagged_run> all;
+        for (std::size_t m=0; m<members.size(); ++m) {
+            const auto runs=patterns::make_runs(pat.select(members[m], 0), dims, 0, 0);
+            for (std::size_t k=0; k<runs.size(); ++k) all.push_back({runs[k].pos, runs[k].length, m, k});
+            if (m==me) mine=runs;
+        }
+        std::sort(all.begin(), all.end(), [](const tagged_run& a, const tagged_run& b) { return a.pos<b.pos; });
+
+        total=0;
+        for (std::size_t i=0; i<all.size(); ++i) {
+            if (i>0 && all[i-1].pos+all[i-1].length>all[i].pos) {
+                throw std::runtime_error("aggregate=node needs the processes to access distinct elements");
+            }
+            if (all[i].member==me) mine[all[i].index].buf=total;
+            total+=all[i].length;
+        }
+        return mine;
+    }
+
+    /// Selects in `space` the elements of all `members`: the union of their hyperslabs, or their points in the file order
+    inline void select_union(hid_t space, const patterns::pattern& pat, const std::vector<int>& members)
+    {
+        std::vector<patterns::selection> sels;
+        bool any_points=false;
+        for (int r: members) {
+            sels.push_back(pat.select(r, 0));
+            any_points= any_points || sels.back().is_points;
+        }
+
+        if (!any_points) {
+            auto op=H5S_SELECT_SET;
+            for (const auto& sel: sels) {
+                if (sel.size()==0) continue;
+                sel.apply(space, op);
+                op=H5S_SELECT_OR;
+            }
+            if (op==H5S_SELECT_SET) h5::check_error(H5Sselect_none(space));
+            return;
+        }
+
+        const auto dims=pat.dims();
+        const std::size_t nd=dims.size();
+        std::vector<hsize_t> pos;
+        for (const auto& sel: sels) {
+            for (const auto& r: patterns::make_runs(sel, dims, 0, 0)) {
+                for (hsize_t j=0; j<r.length; ++j) pos.push_back(r.pos+j);
+            }
+        }
+        std::sort(pos.begin(), pos.end());
+        std::vector<hsize_t> coords(pos.size()*nd);
+        for (std::size_t i=0; i<pos.size(); ++i) {
+            hsize_t p=pos[i];
+            for (std::size_t d=nd; d>0; --d) {
+                coords[i*nd+d-1]=p%dims[d-1];
+                p/=dims[d-1];
+            }
+        }
+        patterns::selection::points(nd, coords).apply(space);
+    }
+
+
+    /// Outcome of reading the data back, reduced over the processes
+    struct read_result {
+        double time;             ///< time of the reads only
+        double mbytes;
+        std::string io_mode;     ///< of the last read (as seen by rank 0)
+        std::uint64_t checksum;  ///< global checksum of the values read
+        std::size_t bad_pieces;  ///< number of pieces with a wrong checksum
+        std::size_t bad_values;  ///< number of wrong values in these pieces
+    };
+
+    /// Reads the elements of the pattern `pat` back and compares them with the values that were written
+    /**
+       The elements are read in pieces of at most `readbuf` MB, so that the read-back does not
+       double the memory footprint. The checksum of each piece is compared with that of the
+       expected values; the values are compared one by one only on a mismatch. The checksum
+       of each element is keyed with its position, so the global checksum does not depend
+       on the read pattern.
+    */
+    template <typename T>
+    read_result read_back(const options& par, const patterns::pattern& pat, const mpi::communicator& comm, hid_t mem_type,
+                          std::vector<char>& image)
+    {
+        const auto dims=pat.dims();
+        hsize_t dset_size=1;
+        for (auto d: dims) dset_size*=d;
+        const std::size_t ndsets=pat.ndatasets();
+        const hsize_t max_size=std::max<hsize_t>(1, par.read_mb*1024*1024/sizeof(T));
+
+        // the core driver refuses to open an image under the name of a file on disk: name a path that cannot exist
+        auto fapl = h5::plist_wrapper(file_access(comm, par, &image));
+        auto file_id = h5::fd_wrapper(h5::open_file(par.storage=="core"? par.file_name+"/image" : par.file_name,
+                                                    H5F_ACC_RDONLY, fapl));
+        fapl.close();
+        auto xfer_plist_id = h5::plist_wrapper(transfer(par));
+        auto dapl = h5::plist_wrapper(dataset_access(par));
+
+        read_result res={0., 0., "", 0, 0, 0};
+        std::vector<T> buf, expected, unused;
+        hsize_t nread=0;
+        double my_time=0;
+        for (std::size_t d=0; d<ndsets; ++d) {
+            auto dset_id = h5::dset_wrapper(h5::open_dataset(file_id, dataset_name(par.data_name, d, ndsets), dapl));
+            auto filespace = h5::dspace_wrapper(H5Dget_space(dset_id));
+            const auto pieces=pat.select(comm.rank(), d).split(max_size);
+
+            // the number of reads is the same on all processes, as required for collective reads
+            const std::size_t npieces=mpi::all_reduce(comm, pieces.size(), MPI_MAX);
+            for (std::size_t i=0; i<npieces; ++i) {
+                const auto piece= i<pieces.size()? pieces[i] : patterns::selection::none(dims.size());
+                const hsize_t n=piece.size();
+                piece.apply(filespace);
+                auto memspace = h5::dspace_wrapper(memory_space(n));
+                buf.resize(std::max<hsize_t>(n, 1));
+
+                const double t0=mpi::wtime();
+                h5::check_error(h5::read(dset_id, mem_type, memspace, filespace, xfer_plist_id, buf.data()));
+                my_time+=mpi::wtime()-t0;
+                nread+=n;
+
+                const auto runs=patterns::make_runs(piece, dims, d*dset_size, 0);
+                hsize_t unused_size;
+                expected.resize(buf.size());
+                generate(expected.data(), runs, make_tasks(runs, 0, unused_size), unused, 1, 0);
+                std::uint64_t cs_read=0, cs_expected=0;
+                for (const auto& r: runs) {
+                    cs_read+=checksum::sum(buf.data()+r.buf, r.length, r.pos);
+                    cs_expected+=checksum::sum(expected.data()+r.buf, r.length, r.pos);
+                }
+                res.checksum+=cs_read;
+                if (cs_read==cs_expected) continue;
+
+                ++res.bad_pieces;
+                for (const auto& r: runs) {
+                    for (hsize_t j=0; j<r.length; ++j) {
+                        if (h5::same_bytes(buf[r.buf+j], expected[r.buf+j])) continue;
+                        if (res.bad_values==0) {
+                            std::cerr << "Rank " << comm.rank() << ": first wrong value in dataset " << d
+                                      << ", at offset " << r.pos+j-d*dset_size << std::endl;
+                        }
+                        ++res.bad_values;
+                    }
+                }
+            }
+        }
+        res.io_mode=io_mode(par, xfer_plist_id);
+        res.time=mpi::all_reduce(comm, my_time, MPI_MAX);
+        res.mbytes=mpi::all_reduce(comm, double(nread), MPI_SUM)*sizeof(T)/(1024.*1024.);
+        res.checksum=mpi::all_reduce(comm, res.checksum, MPI_SUM);
+        res.bad_pieces=mpi::all_reduce(comm, res.bad_pieces, MPI_SUM);
+        res.bad_values=mpi::all_reduce(comm, res.bad_values, MPI_SUM);
+        return res;
+    }
+
+
+    /// Writes (and optionally reads back) elements of type `T` in the requested pattern; returns the exit status
+    /**
+       `result` gets the timings, `memory` the memory footprint, reduced over the processes,
+       and `layout` the alignment to stripes.
+    */
+    template <typename T>
+    int run_benchmark(const options& par, const mpi::communicator& comm, sweep::point_result& result,
+                      footprint::report& memory, striping::report& layout)
+    {
+        using std::cout;
+        using std::endl;
+
+        const int master=0;
+        bool is_master = comm.rank()==master;
+
+        auto mem_type = h5::type_wrapper(h5::type_traits<T>::memory_type());
+        auto file_type = h5::type_wrapper(h5::type_traits<T>::file_type(par.swap_order));
+
+        const auto params=par.params();
+        const auto pat=patterns::create(par.pattern, params, comm.size(), sizeof(T));
+        const auto dims=pat->dims();
+        hsize_t dset_size=1;
+        for (auto d: dims) dset_size*=d;
+        const std::size_t ndsets=pat->ndatasets();
+
+        // the peak memory is measured from here, for each phase
+        footprint::reset_peak();
+        const auto mem_start=footprint::sample::take();
+
+        /*
+         * The runs of this process, in the buffer order. With node aggregation, the processes
+         * of a node place their runs into a shared buffer in the file order, and only the node
+         * leader writes, over the cross-node communicator. Otherwise, a pattern may lay
+         * the buffer of a dataset out as an array (e.g., with ghost cells), of which only
+         * some elements are written.
+         */
+        std::unique_ptr<aggregation::node_aggregator<T>> agg;
+        std::vector<patterns::selection> sels;
+        std::vector< std::vector<hsize_t> > mem_dims(ndsets);
+        std::vector<patterns::selection> mem_sels(ndsets, patterns::selection::none(1));
+        std::vector<hsize_t> buf_offset(ndsets+1, 0);
+        std::vector<patterns::run> runs;
+        hsize_t my_count=0, node_count=0;
+        if (par.aggregate=="node") {
+            my_count=pat->select(comm.rank(), 0).size();
+            agg.reset(new aggregation::node_aggregator<T>(comm, mpi::all_reduce(comm, my_count, MPI_MAX)));
+            runs=node_runs(*pat, agg->members(), agg->node().rank(), node_count);
+        } else {
+            for (std::size_t d=0; d<ndsets; ++d) {
+                sels.push_back(pat->select(comm.rank(), d));
+                my_count+=sels[d].size();
+                std::vector<patterns::run> dset_runs;
+                if (pat->buffer_layout(comm.rank(), d, mem_dims[d], mem_sels[d])) {
+                    dset_runs=patterns::pair_runs(patterns::make_runs(sels[d], dims, d*dset_size, 0),
+                                                  patterns::make_runs(mem_sels[d], mem_dims[d], buf_offset[d], 0));
+                    hsize_t mem_size=1;
+                    for (auto m: mem_dims[d]) mem_size*=m;
+                    buf_offset[d+1]=buf_offset[d]+mem_size;
+                } else {
+                    dset_runs=patterns::make_runs(sels[d], dims, d*dset_size, buf_offset[d]);
+                    buf_offset[d+1]=buf_offset[d]+sels[d].size();
+                }
+                runs.insert(runs.end(), dset_runs.begin(), dset_runs.end());
+            }
+        }
+        const bool is_writer= !agg || agg->is_leader();
+
+        /*
+         * Initialize data buffer, by `threads` threads
+         */
+        std::vector<T> data;
+        T* buf;
+        if (agg) {
+            buf=agg->buffer();
+        } else {
+            data.resize(std::max<hsize_t>(buf_offset[ndsets], 1));
+            buf=data.data();
+        }
+        hsize_t local_size=0;
+        const auto tasks=make_tasks(runs, par.stage, local_size);
+        std::vector<T> local(par.stage>0? local_size : 0);
+
+        comm.barrier();
+        const double tp=mpi::wtime();
+        generate(buf, runs, tasks, local, par.nthreads, par.stage);
+        const double t_prepare=mpi::all_reduce(comm, mpi::wtime()-tp, MPI_MAX);
+        const auto mem_ready=footprint::sample::take();
+        footprint::reset_peak();
+
+        // The clock starts before the aggregated data are synchronized; called by all processes
+        double t0=0;
+        auto start_write=[&]() {
+            comm.barrier();
+            t0=mpi::wtime();
+            if (agg) agg->sync();
+        };
+
+        double my_time=0;
+        std::string io_mode;
+        std::vector<char> image;
+        std::vector<unsigned long long> dset_offsets(ndsets, 0);  // in the file, as written
+        double file_mb=-1;
+        footprint::sample mem_open={-1., -1., -1., -1., -1.};
+        footprint::cache mdc={-1., -1., -1.};
+        if (is_writer) {
+            const mpi::communicator& file_comm= agg? agg->leaders() : comm;
+
+            /*
+             * Create a new file collectively, and the datasets with the requested layout
+             */
+            auto fapl = h5::plist_wrapper(file_access(file_comm, par));
+            auto file_id = h5::fd_wrapper(h5::create_file(par.file_name, H5F_ACC_TRUNC, H5P_DEFAULT, fapl));
+            fapl.close();
+
+            auto dcpl_id = h5::plist_wrapper(dataset_create(par));
+            auto dapl_id = h5::plist_wrapper(dataset_access(par));
+            std::vector< std::unique_ptr<h5::dset_wrapper> > dsets;
+            std::vector< std::unique_ptr<h5::dspace_wrapper> > filespaces, memspaces;
+            for (std::size_t d=0; d<ndsets; ++d) {
+                auto filespace = h5::dspace_wrapper(H5Screate_simple(dims.size(), dims.data(), nullptr));
+                dsets.emplace_back(new h5::dset_wrapper(h5::create_dataset(file_id, dataset_name(par.data_name, d, ndsets),
+                                                                           file_type, filespace,
+                                                                           H5P_DEFAULT, dcpl_id, dapl_id)));
+
+                /*
+                 * Select the elements in the file: the leader selects those of all processes on its node
+                 */
+                filespaces.emplace_back(new h5::dspace_wrapper(H5Scopy(filespace)));
+                if (agg) {
+                    select_union(*filespaces.back(), *pat, agg->members());
+                } else {
+                    pat->select_in(*filespaces.back(), comm.rank(), d);
+                }
+                if (!agg && !mem_dims[d].empty()) {
+                    memspaces.emplace_back(new h5::dspace_wrapper(H5Screate_simple(mem_dims[d].size(), mem_dims[d].data(), nullptr)));
+                    pat->select_buffer_in(*memspaces.back(), comm.rank(), d);
+                } else {
+                    memspaces.emplace_back(new h5::dspace_wrapper(memory_space(agg? node_count : sels[d].size())));
+                }
+            }
+            auto xfer_plist_id = h5::plist_wrapper(transfer(par));
+
+            // The core driver grows its buffer up to the highest offset written, and zero-fills it:
+            // an untimed first write does that, so that the timed one measures the library alone
+            if (par.storage=="core") {
+                for (std::size_t d=0; d<ndsets; ++d) {
+                    h5::check_error(h5::write(*dsets[d], mem_type, *memspaces[d], *filespaces[d],
+                                             xfer_plist_id, buf+buf_offset[d]));
+                }
+            }
+
+            /*
+              Write the data
+            */
+            start_write();
+            for (std::size_t d=0; d<ndsets; ++d) {
+                h5::check_error(h5::write(*dsets[d], mem_type, *memspaces[d], *filespaces[d],
+                                         xfer_plist_id, buf+buf_offset[d]));
+            }
+            my_time=mpi::wtime()-t0;
+            io_mode=bench::io_mode(par, xfer_plist_id);
+            mem_open=footprint::sample::take();
+            mdc=footprint::cache::of(file_id);
+            for (std::size_t d=0; d<ndsets; ++d) dset_offsets[d]=H5Dget_offset(*dsets[d]);
+            hsize_t file_size;
+            if (H5Fget_filesize(file_id, &file_size)>=0) file_mb=file_size/(1024.*1024.);
+
+            // an in-memory file is gone once closed: keep a copy of it to read back
+            if (par.storage=="core" && par.read_pattern!="none") {
+                h5::check_error(H5Fflush(file_id, H5F_SCOPE_LOCAL));
+                const ssize_t size=H5Fget_file_image(file_id, nullptr, 0);
+                if (size>=0) image.resize(size);
+                if (size<0 || H5Fget_file_image(file_id, image.data(), image.size())<0) {
+                    throw std::runtime_error("Cannot copy the in-memory file");
+                }
+            }
+        } else {
+            start_write();
+            my_time=mpi::wtime()-t0;
+        }
+        const double t_write=mpi::all_reduce(comm, my_time, MPI_MAX);
+        const auto mem_write=footprint::sample::take();
+
+        /*
+         * The memory footprint; the aggregators are the node leaders with node aggregation,
+         * and the first process on each node (as chosen by ROMIO by default) with collective I/O
+         */
+        const bool is_aggregator= agg? agg->is_leader() : par.do_collective && par.storage!="core"
+                                                   && comm.split_shared(comm.rank()).rank()==0;
+        memory=footprint::report(comm, is_aggregator);
+        auto add_memory=[&](const std::string& key, double value) {
+            memory.add(key, footprint::spread::reduce(comm, value, is_aggregator));
+        };
+        add_memory("rss_start_MB", mem_start.rss);
+        add_memory("rss_buffers_MB", mem_ready.rss);
+        add_memory("peak_write_MB", mem_write.peak_rss);
+        add_memory("hdf5_alloc_MB", mem_open.h5_current);
+        add_memory("hdf5_alloc_peak_MB", mem_write.h5_peak);
+        add_memory("hdf5_free_lists_MB", mem_write.h5_free_lists);
+        add_memory("mdc_MB", mdc.size);
+        add_memory("mdc_max_MB", mdc.max_size);
+        add_memory("mdc_hit_rate", mdc.hit_rate);
+
+        /*
+         * The alignment to stripes and, for contiguous datasets, the bytes that each stripe
+         * target would get from the selections of the processes
+         */
+        layout=striping::report();
+        if (par.stripe_bytes>0) {
+            layout.stripe=par.stripe_bytes;
+            layout.aligned=par.stripe_align;
+            layout.count=par.stripe_count;
+            layout.padding_mb=double(pat->padding())*ndsets*sizeof(T)/(1024.*1024.);
+            layout.data_mb=double(dset_size)*ndsets*sizeof(T)/(1024.*1024.);
+            layout.file_mb=mpi::all_reduce(comm, file_mb, MPI_MAX);
+            MPI_Allreduce(MPI_IN_PLACE, dset_offsets.data(), ndsets, MPI_UNSIGNED_LONG_LONG, MPI_MAX, comm);
+            const bool known=std::none_of(dset_offsets.begin(), dset_offsets.end(),
+                                          [](unsigned long long off) { return off==HADDR_UNDEF; });
+            if (par.stripe_count>0 && known) {
+                layout.targets=striping::balance(par.stripe_bytes, par.stripe_count);
+                for (std::size_t d=0; d<ndsets; ++d) {
+                    for (const auto& r: patterns::make_runs(pat->select(comm.rank(), d), dims, 0, 0)) {
+                        layout.targets.add(dset_offsets[d]+r.pos*sizeof(T), r.length*sizeof(T));
+                    }
+                }
+                layout.targets.reduce(comm);
+            }
+        }
+
+        const double mbytes=mpi::all_reduce(comm, double(my_count), MPI_SUM)*sizeof(T)/(1024.*1024.);
+        result={par.point, t_prepare, t_write, mbytes, io_mode, 0., 0., ""};
+        const int nwriters=mpi::all_reduce(comm, int(is_writer), MPI_SUM);
+        const int procs_per_node= agg? mpi::all_reduce(comm, int(agg->members().size()), MPI_MAX) : 1;
+        if (is_master) {
+            cout << std::fixed << std::setprecision(6)
+                 << "prepare: time=" << t_prepare << " s on " << comm.size() << " processes x "
+                 << par.nthreads << " threads" << (par.stage>0? " (with staging)" : "") << "\n"
+                 << "write " << par.pattern << ": time=" << t_write << " s, "
+                 << std::setprecision(2) << mbytes/t_write << " MB/s, "
+                 << h5::type_traits<T>::name() << (par.swap_order? " (byte-swapped in file)" : "")
+                 << ", " << io_mode;
+            if (par.storage!="disk") cout << ", storage=" << par.storage << " (no disk I/O)";
+            if (par.vfd.name!="mpio") cout << ", " << drivers::text(par.vfd) << " driver";
+            if (agg) {
+                cout << " (aggregated: " << nwriters << " writers, up to "
+                     << procs_per_node << " processes per node)";
+            }
+            cout << std::defaultfloat << endl;
+            layout.print(cout);
+        }
+        if (par.read_pattern=="none") {
+            if (is_master) memory.print(cout);
+            return 0;
+        }
+
+        /*
+          Reopen the file by all processes and read the data back in a possibly different access pattern
+        */
+        const auto read_pat=patterns::create(par.read_pattern, params, comm.size(), sizeof(T));
+        footprint::reset_peak();
+        const auto res=read_back<T>(par, *read_pat, comm, mem_type, image);
+        add_memory("peak_read_MB", footprint::sample::take().peak_rss);
+        result.read_time=res.time;
+        result.read_mbytes=res.mbytes;
+        result.read_mode=res.io_mode;
+        if (is_master) {
+            cout << std::fixed << std::setprecision(6)
+                 << "read " << par.read_pattern << ": time=" << res.time << " s, "
+                 << std::setprecision(2) << res.mbytes/res.time << " MB/s"
+                 << " (" << res.mbytes << " MB, " << (par.chunk.empty()? "contiguous" : "chunked") << " layout), "
+                 << "checksum=" << std::hex << res.checksum << std::dec
+                 << ", mismatched pieces=" << res.bad_pieces
+                 << ", wrong values=" << res.bad_values
+                 << ", " << res.io_mode
+                 << std::defaultfloat << endl;
+            memory.print(cout);
+        }
+        return res.bad_values!=0? 1 : 0;
+    }
+
+
+    /// Runs the benchmark for the element type chosen at run time
+    struct benchmark_runner {
+        const options& par;
+        const mpi::communicator& comm;
+        int status;
+        sweep::point_result result;
+        footprint::report memory;
+        striping::report layout;
+
+        template <typename T>
+        void run() { status=run_benchmark<T>(par, comm, result, memory, layout); }
+    };
+
+
+    /// Appends the I/O of a point, as done by `nprocs` processes, to a trace for `h5replay`; false if the pattern has point selections
+    inline bool record_point(std::ostream& out, const options& par, int nprocs)
+    {
+        type_size tsize={0};
+        h5::dispatch_type(par.type_name, tsize);
+        const auto pat=patterns::create(par.pattern, par.params(), nprocs, tsize.size);
+        std::vector<std::string> names;
+        for (std::size_t d=0; d<pat->ndatasets(); ++d) names.push_back(dataset_name(par.data_name, d, pat->ndatasets()));
+
+        std::ostringstream ops;
+        if (!par.point.empty()) ops << "# point " << par.point << "\n";
+        ops << "file create " << par.file_name << "\n";
+        for (const auto& name: names) {
+            ops << "dataset create " << name << " " << par.type_name << " " << replay::extents(pat->dims()) << " "
+                << (par.chunk.empty()? "contiguous" : replay::extents(par.chunk)) << "\n";
+        }
+        if (!replay::write_step(ops, "write", *pat, nprocs, names)) return false;
+        ops << "file close\n";
+        if (par.read_pattern!="none") {
+            const auto read_pat=patterns::create(par.read_pattern, par.params(), nprocs, tsize.size);
+            ops << "file open " << par.file_name << "\n";
+            if (!replay::write_step(ops, "read", *read_pat, nprocs, names)) return false;
+            ops << "file close\n";
+        }
+        out << ops.str();
+        return true;
+    }
+
+
+    /// Gathers the traced HDF5 calls of all processes into a Chrome trace file, written by `root`
+    /**
+       `t_sync` is the time of `h5::trace::now()` on each process right after a barrier;
+       the timeline starts there on all processes.
+    */
+    inline void write_trace(const mpi::communicator& comm, int root, const std::string& file_name, double t_sync)
+    {
+        const auto& recorder=h5::trace::global();
+        const auto events=recorder.events();
+        const auto all=mpi::gather(comm, h5::trace::chrome_events(events, comm.rank(), t_sync), root);
+        const auto ncalls=mpi::all_reduce(comm, events.size(), MPI_SUM);
+        const auto dropped=mpi::all_reduce(comm, recorder.dropped(), MPI_SUM);
+        if (comm.rank()!=root) return;
+
+        std::ofstream out(file_name);
+        out << "{\"traceEvents\":[\n";
+        for (std::size_t i=0; i<all.size(); ++i) out << (i>0? ",\n" : "") << all[i];
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        if (!out) {
+            std::cerr << "Cannot write the trace file " << file_name << std::endl;
+            return;
+        }
+        std::cout << "trace: " << ncalls << " HDF5 calls of " << comm.size() << " processes written to "
+                  << file_name << " (" << dropped << " dropped)" << std::endl;
+    }
+
+
+    /// The `main()` of `h5bench` and of its aliases
+    /**
+       `program` names the program in the results records. The pattern is given by the
+       `pattern` parameter, `default_pattern` if it is missing (if empty, the parameter
+       is required). An alias may pass `translate` to map its own parameters to those
+       of `h5bench` at each sweep point.
+    */
+    inline int run_program(int argc, char** argv, const std::string& program,
+                           const std::string& default_pattern, translator translate=nullptr)
+    {
+        using std::cout;
+
+        // the threads preparing the buffers do not call MPI
+        mpi::environment env(argc, argv, drivers::thread_level(argc, argv, MPI_THREAD_FUNNELED));
+        mpi::communicator comm;
+        const int master=0;
+        bool is_master = comm.rank()==master;
+
+        const auto maybe_par = parse_and_bcast(comm, master, [&]() {
+            return parse_points(argc, argv, comm.size(), default_pattern, translate);
+        });
+        if (!maybe_par) {
+            env.abort(3);
+            return 3;
+        }
+        const auto& points = *maybe_par;
+
+        // The parameters (of the first point of a sweep) are the same on all processes
+        const auto info=results::run_info::collect(comm, master);
+        if (is_master) {
+            const auto& par=points.front();
+            type_size tsize={0};
+            h5::dispatch_type(par.type_name, tsize);
+            results::record rec;
+            add_params(rec, par, *patterns::create(par.pattern, par.params(), comm.size(), tsize.size));
+            cout << "Running " << program << " with " << rec.text()
+                 << "\non " << info.summary()
+                 << std::endl;
+        }
+        results::writer out(is_master? points.front().results_file : "", points.front().results_format);
+
+        // The calls of all points are traced into one timeline, which starts here
+        const std::string& trace_file=points.front().trace_file;
+        double t_sync=0;
+        if (!trace_file.empty()) {
+            h5::trace::global().enable(points.front().trace_events);
+            comm.barrier();
+            t_sync=h5::trace::now();
+        }
+
+        // The I/O of all points is recorded into one trace for `h5replay`
+        std::ofstream record;
+        if (is_master && !points.front().record_file.empty()) {
+            record.open(points.front().record_file);
+            record << "ranks " << comm.size() << "\n";
+        }
+
+        // a file in tmpfs is only seen by the processes of one node
+        const bool one_node= comm.split_shared(comm.rank()).size()==comm.size();
+
+        std::vector<sweep::point_result> point_results;
+        bool refused=false;
+        for (std::size_t i=0; i<points.size(); ++i) {
+            const auto& par=points[i];
+            if (is_master && points.size()>1) {
+                cout << "point " << i << " of " << points.size() << ": " << par.point << std::endl;
+            }
+            if (par.storage=="tmpfs" && !one_node) {
+                if (is_master) std::cerr << "storage=tmpfs needs all processes on one node\n";
+                if (!trace_file.empty()) write_trace(comm, master, trace_file, t_sync);
+                return 3;
+            }
+            if (env.thread_level()<drivers::thread_level(par.vfd.name)) {
+                if (is_master) std::cerr << "The " << par.vfd.name << " driver needs MPI_THREAD_MULTIPLE\n";
+                if (!trace_file.empty()) write_trace(comm, master, trace_file, t_sync);
+                return 3;
+            }
+            benchmark_runner runner={par, comm, 0, {}, {}, {}};
+            h5::dispatch_type(par.type_name, runner);
+            if (runner.status!=0) {
+                if (!trace_file.empty()) write_trace(comm, master, trace_file, t_sync);
+                return runner.status;
+            }
+            point_results.push_back(runner.result);
+
+            if (record.is_open() && !record_point(record, par, comm.size())) {
+                std::cerr << "The pattern " << par.pattern << " has point selections, which cannot be recorded\n";
+            }
+
+            if (!par.results_file.empty()) {
+                MPI_Info hints=make_info(par.hints);
+                const auto effective= par.storage=="core" || par.vfd.name!="mpio"? std::vector<std::string>()
+                                                          : mpi::file_hints(comm, par.file_name, hints);
+                if (hints!=MPI_INFO_NULL) MPI_Info_free(&hints);
+                if (is_master) {
+                    type_size tsize={0};
+                    h5::dispatch_type(par.type_name, tsize);
+                    results::record rec;
+                    rec.add("program", program).add("date", results::utc_time());
+                    add_params(rec, par, *patterns::create(par.pattern, par.params(), comm.size(), tsize.size));
+                    results::add_result(rec, runner.result, "read");
+                    runner.memory.add_to(rec);
+                    runner.layout.add_to(rec);
+                    info.add_to(rec);
+                    rec.add("hints", results::join(effective, " "));
+                    if (!out.write(rec)) {
+                        std::cerr << "The columns of point " << i << " differ from those of " << par.results_file
+                                  << "; its record is not written (use format=json for records with different columns)\n";
+                        refused=true;
+                    }
+                }
+            }
+        }
+        if (is_master && points.size()>1) sweep::print_table(cout, point_results, "read");
+        if (!trace_file.empty()) write_trace(comm, master, trace_file, t_sync);
+
+        return refused? 3 : 0;
+    }
+}
@@ -0,0 +1,67 @@
+/** @file checksum.hpp
+    A fast position-sensitive checksum of arrays of elements
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace checksum {
+
+    namespace detail {
+        /// The bits of an element folded into a 64-bit word
+        template <typename T>
+        inline std::uint64_t bits(const T* elem)
+        {
+            const std::size_t nwords=(sizeof(T)+7)/8;
+            std::uint64_t w[nwords]={};
+            std::memcpy(w, elem, sizeof(T));
+            std::uint64_t x=w[0];
+            for (std::size_t k=1; k<nwords; ++k) {
+                const unsigned r=(13*k)%64;
+                x ^= (r==0)? w[k] : (w[k]<<r | w[k]>>(64-r));
+            }
+            return x;
+        }
+    }
+
+    /// Checksum of `n` elements, the first of which is at logical position `first`
+    /**
+       The checksum is a sum over the elements, each mixed with its position,
+       so that the checksums of consecutive pieces of an array can simply be added
+       up (also across processes, with `MPI_SUM`), and a value moved to a wrong
+       place is detected. Elements larger than 64 bits are folded into 64 bits first.
+
+       The loop runs over several independent lanes to let the compiler vectorize it.
+    */
+    template <typename T>
+    inline std::uint64_t sum(const T* data, std::size_t n, std::uint64_t first)
+    {
+        const std::uint64_t key_step=0x9E3779B97F4A7C15ull; // 2^64 divided by the golden ratio
+        const std::size_t nlanes=8;
+
+        // the position keys advance by addition only, as there is no vector 64-bit multiply before AVX-512
+        std::uint64_t acc[nlanes]={};
+        std::uint64_t key[nlanes];
+        for (std::size_t l=0; l<nlanes; ++l) key[l]=(first+l)*key_step;
+
+        std::size_t i=0;
+        for (; i+nlanes<=n; i+=nlanes) {
+            for (std::size_t l=0; l<nlanes; ++l) {
+                std::uint64_t v= detail::bits(data+i+l) ^ key[l];
+                v ^= v>>29;
+                acc[l] += v;
+                key[l] += nlanes*key_step;
+            }
+        }
+        std::uint64_t total=0;
+        for (; i<n; ++i) {
+            std::uint64_t v= detail::bits(data+i) ^ ((first+i)*key_step);
+            v ^= v>>29;
+            total += v;
+        }
+        for (auto a: acc) total+=a;
+        return total;
+    }
+}
@@ -1,8 +1,13 @@
 /** @file Simple command line argument parsing library */
+#pragma once
 
 #include <string>
 #include <sstream>
 #include <map>
+#include <vector>
+#include <stdexcept>
+#include <climits>
+#include <algorithm>
 
 namespace program_options {
 
@@ -67,7 +72,76 @@ namespace program_options {
             }
             return optional<bool>();
         }
-        
+
+        /// Parses an integer with an optional binary suffix: k (2^10), M (2^20), G (2^30), T (2^40)
+        /** Empty if the value does not fit in `long long`. */
+        inline optional<long long> try_size_cast(const std::string& s) {
+            if (s.empty()) return optional<long long>();
+            int shift=0;
+            switch (s.back()) {
+              case 'k': case 'K': shift=10; break;
+              case 'M': shift=20; break;
+              case 'G': shift=30; break;
+              case 'T': shift=40; break;
+            }
+            auto maybe_val=try_lexical_cast<long long>(shift? s.substr(0, s.size()-1) : s);
+            if (!maybe_val) return maybe_val;
+            if (*maybe_val>(LLONG_MAX>>shift) || *maybe_val<-(LLONG_MAX>>shift)) return optional<long long>();
+            return make_optional(*maybe_val * (1LL<<shift));
+        }
+
+        /// Expands the range `lo..hi`, `lo..hi:+step` or `lo..hi:xfactor` into `out`; returns false if `s` is not a range
+        inline bool try_expand_range(const std::string& s, std::vector<std::string>& out) {
+            using std::string;
+            const auto dots=s.find("..");
+            if (dots==string::npos) return false;
+            const auto colon=s.find(':', dots);
+            const auto lo=try_size_cast(s.substr(0, dots));
+            const auto hi=try_size_cast(s.substr(dots+2, colon==string::npos? string::npos : colon-dots-2));
+            if (!lo || !hi || *hi<*lo) return false;
+
+            bool geometric=false;
+            long long step=1;
+            if (colon!=string::npos) {
+                const string spec=s.substr(colon+1);
+                if (spec.empty() || (spec[0]!='x' && spec[0]!='+')) return false;
+                geometric= spec[0]=='x';
+                const auto maybe_step=try_size_cast(spec.substr(1));
+                if (!maybe_step) return false;
+                step=*maybe_step;
+            }
+            if (geometric? (step<2 || *lo<1) : step<1) return false;
+
+            for (long long v=*lo; ; ) {
+                out.push_back(std::to_string(v));
+                // the differences are computed unsigned, as `hi-step` may overflow
+                if (geometric? v>*hi/step : static_cast<unsigned long long>(*hi)-static_cast<unsigned long long>(v)<static_cast<unsigned long long>(step)) break;
+                v= geometric? v*step : v+step;
+            }
+            return true;
+        }
+
+        /// Expands a parameter value into the list of values it stands for
+        /**
+           The value is a comma-separated list of items; each item is either a range
+           (see `try_expand_range()`), or an integer with an optional size suffix,
+           or any other string, taken verbatim.
+        */
+        inline std::vector<std::string> expand_value(const std::string& value) {
+            std::vector<std::string> out;
+            std::string::size_type pos=0;
+            while (true) {
+                const auto comma=value.find(',', pos);
+                const std::string item=value.substr(pos, comma==std::string::npos? std::string::npos : comma-pos);
+                if (!try_expand_range(item, out)) {
+                    const auto maybe_size=try_size_cast(item);
+                    out.push_back(maybe_size? std::to_string(*maybe_size) : item);
+                }
+                if (comma==std::string::npos) break;
+                pos=comma+1;
+            }
+            return out;
+        }
     }
     
     
@@ -101,7 +175,23 @@ namespace program_options {
             return get_or(key, std::string(deflt));
         }
 
+        /// Sets the value of the parameter `key`
+        void set(const std::string& key, const std::string& value)
+        {
+            map_[key]=value;
+        }
+
+        /// The keys of all parameters, in alphabetical order
+        std::vector<std::string> keys() const
+        {
+            std::vector<std::string> out;
+            for (const auto& kv: map_) out.push_back(kv.first);
+            return out;
+        }
+
         friend optional<params_map> parse(int argc, const char* const* argv);
+        friend std::vector<params_map> expand_sweeps(const params_map& p, const std::vector<std::string>& verbatim);
+        friend std::vector<std::string> swept_keys(const params_map& p, const std::vector<std::string>& verbatim);
     };
 
     
@@ -120,4 +210,47 @@ namespace program_options {
         return return_type(p);
     }
 
+
+
+    /// Expands the parameter sweeps of `p` into the cartesian product of the parameter values
+    /**
+       Each value may be a comma-separated list, such as `gap=0,8,4096`, whose items may be
+       ranges such as `blocksize=1k..64M:x2` (geometric), `rows=100..1000:+100` (arithmetic)
+       or `repeat=1..4` (step 1). Integers may have a size suffix k, M, G or T (powers of 2^10),
+       which is expanded, e.g. `64k` becomes `65536`. The last key (in the alphabetical
+       order) varies fastest. The values of the keys listed in `verbatim` (such as file names)
+       are neither split nor expanded.
+    */
+    inline std::vector<params_map> expand_sweeps(const params_map& p, const std::vector<std::string>& verbatim={}) {
+        std::vector<std::string> keys;
+        std::vector<std::vector<std::string>> values;
+        for (const auto& kv: p.map_) {
+            keys.push_back(kv.first);
+            const bool as_is= std::find(verbatim.begin(), verbatim.end(), kv.first)!=verbatim.end();
+            values.push_back(as_is? std::vector<std::string>{kv.second} : detail::expand_value(kv.second));
+        }
+
+        std::vector<params_map> points;
+        std::vector<std::size_t> idx(keys.size(), 0);
+        while (true) {
+            params_map point;
+            for (std::size_t k=0; k<keys.size(); ++k) point.map_[keys[k]]=values[k][idx[k]];
+            points.push_back(point);
+
+            std::size_t k=keys.size();
+            while (k>0 && ++idx[k-1]==values[k-1].size()) idx[--k]=0;
+            if (k==0) break;
+        }
+        return points;
+    }
+
+    /// The keys of the parameters of `p` which take more than one value; the keys in `verbatim` take one
+    inline std::vector<std::string> swept_keys(const params_map& p, const std::vector<std::string>& verbatim={}) {
+        std::vector<std::string> keys;
+        for (const auto& kv: p.map_) {
+            if (std::find(verbatim.begin(), verbatim.end(), kv.first)!=verbatim.end()) continue;
+            if (detail::expand_value(kv.second).size()>1) keys.push_back(kv.first);
+        }
+        return keys;
+    }
 }
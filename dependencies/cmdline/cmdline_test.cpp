@@ -37,6 +37,14 @@ TEST_F(program_options_Test, derefParams) {
     EXPECT_EQ(1111,*maybe_number);
 }
 
+TEST_F(program_options_Test, keysAndSet) {
+    EXPECT_EQ(std::vector<string>({"a_number", "a_string", "an_option"}), params.keys());
+    params.set("b_string", "world");
+    params.set("a_number", "2222");
+    EXPECT_EQ(std::vector<string>({"a_number", "a_string", "an_option", "b_string"}), params.keys());
+    EXPECT_EQ(2222, *params.get<int>("a_number"));
+    EXPECT_EQ("world", *params.get<string>("b_string"));
+}
 
 TEST_F(program_options_Test, intNumber) {
     auto maybe_number=params.get<int>("a_number");
@@ -135,3 +143,86 @@ TEST_F(program_options_Test, missingBoolDefault) {
     EXPECT_FALSE(*maybe_option);
 }
 
+
+
+struct sweep_Test: public ::testing::Test {
+    using string=std::string;
+    using strings=std::vector<std::string>;
+
+    static po::params_map parse(const std::vector<const char*>& args) {
+        std::vector<const char*> argv={"program.x"};
+        argv.insert(argv.end(), args.begin(), args.end());
+        return *po::parse(argv.size(), argv.data());
+    }
+
+    static strings values(const std::vector<po::params_map>& points, const string& key) {
+        strings vals;
+        for (const auto& p: points) vals.push_back(*p.get<string>(key));
+        return vals;
+    }
+};
+
+
+TEST_F(sweep_Test, noSweep) {
+    auto points=po::expand_sweeps(parse({"a_number=1111", "a_string=hello"}));
+    ASSERT_EQ(1u, points.size());
+    EXPECT_EQ(1111, *points[0].get<int>("a_number"));
+    EXPECT_EQ("hello", *points[0].get<string>("a_string"));
+    EXPECT_TRUE(po::swept_keys(parse({"a_number=1111"})).empty());
+}
+
+
+TEST_F(sweep_Test, sizeSuffix) {
+    auto points=po::expand_sweeps(parse({"size=64k", "big=2G"}));
+    ASSERT_EQ(1u, points.size());
+    EXPECT_EQ(65536, *points[0].get<long>("size"));
+    EXPECT_EQ(2147483648L, *points[0].get<long>("big"));
+}
+
+
+TEST_F(sweep_Test, list) {
+    auto points=po::expand_sweeps(parse({"gap=0,8,4096", "name=a,b"}));
+    EXPECT_EQ(strings({"0","0","8","8","4096","4096"}), values(points, "gap"));
+    EXPECT_EQ(strings({"a","b","a","b","a","b"}), values(points, "name"));
+    EXPECT_EQ(strings({"gap","name"}), po::swept_keys(parse({"gap=0,8,4096", "name=a,b", "rows=10"})));
+}
+
+
+TEST_F(sweep_Test, geometricRange) {
+    auto points=po::expand_sweeps(parse({"blocksize=1k..10k:x2"}));
+    EXPECT_EQ(strings({"1024","2048","4096","8192"}), values(points, "blocksize"));
+}
+
+
+TEST_F(sweep_Test, arithmeticRange) {
+    EXPECT_EQ(strings({"-4","-1","2"}), values(po::expand_sweeps(parse({"gap=-4..2:+3"})), "gap"));
+    EXPECT_EQ(strings({"1","2","3"}), values(po::expand_sweeps(parse({"repeat=1..3"})), "repeat"));
+    EXPECT_EQ(strings({"1","5","6","7"}), values(po::expand_sweeps(parse({"repeat=1,5..7"})), "repeat"));
+}
+
+
+TEST_F(sweep_Test, notARange) {
+    EXPECT_EQ(strings({"../out.h5"}), values(po::expand_sweeps(parse({"file=../out.h5"})), "file"));
+    EXPECT_EQ(strings({"1..8:x1"}), values(po::expand_sweeps(parse({"size=1..8:x1"})), "size"));
+    EXPECT_EQ(strings({"8..1"}), values(po::expand_sweeps(parse({"size=8..1"})), "size"));
+}
+
+
+TEST_F(sweep_Test, sizeOverflow) {
+    EXPECT_EQ(strings({"100000000T"}), values(po::expand_sweeps(parse({"size=100000000T"})), "size"));
+    EXPECT_EQ(strings({"9223370937343148032"}), values(po::expand_sweeps(parse({"size=8388607T"})), "size"));
+    EXPECT_EQ(strings({"8388608T"}), values(po::expand_sweeps(parse({"size=8388608T"})), "size"));
+    EXPECT_EQ(strings({"1..100000000T:x2"}), values(po::expand_sweeps(parse({"size=1..100000000T:x2"})), "size"));
+    EXPECT_EQ(strings({"9223372036854775806","9223372036854775807"}),
+              values(po::expand_sweeps(parse({"size=9223372036854775806..9223372036854775807"})), "size"));
+}
+
+
+TEST_F(sweep_Test, verbatim) {
+    const strings verbatim={"file", "name"};
+    auto points=po::expand_sweeps(parse({"file=a,b.h5", "name=64k", "gap=0,8"}), verbatim);
+    EXPECT_EQ(strings({"a,b.h5","a,b.h5"}), values(points, "file"));
+    EXPECT_EQ(strings({"64k","64k"}), values(points, "name"));
+    EXPECT_EQ(strings({"0","8"}), values(points, "gap"));
+    EXPECT_EQ(strings({"gap"}), po::swept_keys(parse({"file=a,b.h5", "gap=0,8"}), verbatim));
+}
@@ -1,9 +1,13 @@
 /* C++ wrappers around a few MPI calls, inspired by boost::mpi and ALPCore */
+#pragma once
 
 #include <mpi.h>
 #include <type_traits>
 #include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 namespace mpiwrap {
 
@@ -17,6 +21,15 @@ namespace mpiwrap {
             if (!is_in) MPI_Init(&argc, &argv);
         }
 
+        /// initialize requesting a thread support level (`MPI_THREAD_FUNNELED` etc.)
+        environment(int argc, char** argv, int required_level)
+        {
+            int is_in;
+            MPI_Initialized(&is_in);
+            int provided;
+            if (!is_in) MPI_Init_thread(&argc, &argv, required_level, &provided);
+        }
+
         virtual ~environment()
         {
             int flag;
@@ -31,25 +44,71 @@ namespace mpiwrap {
         {
             MPI_Abort(MPI_COMM_WORLD, rc);
         }
+
+        /// thread support level actually provided by the MPI library
+        int thread_level() const
+        {
+            int provided;
+            MPI_Query_thread(&provided);
+            return provided;
+        }
     };
 
 
     /// wrapper around MPI communicator
     class communicator {
         MPI_Comm comm_;
+        bool owned_; ///< whether the communicator has to be freed on destruction
+
+        /// appropriate an existing MPI communicator
+        explicit communicator(MPI_Comm comm): comm_(comm), owned_(comm!=MPI_COMM_NULL) {}
+
       public:
         /// create a WORLD communicator
-        communicator(): comm_(MPI_COMM_WORLD) {}
+        communicator(): comm_(MPI_COMM_WORLD), owned_(false) {}
 
         // TODO: if needed, construct from an existing MPI communicator
-        //       by appropriating or duplicating
-        
+        //       by duplicating
+
         communicator(const communicator&) =delete;
         communicator& operator=(const communicator&) =delete;
 
+        communicator(communicator&& other): comm_(other.comm_), owned_(other.owned_)
+        {
+            other.comm_=MPI_COMM_NULL;
+            other.owned_=false;
+        }
+
+        ~communicator()
+        {
+            if (!owned_) return;
+            int flag;
+            MPI_Finalized(&flag);
+            if (!flag) MPI_Comm_free(&comm_);
+        }
+
         /// implicitly convert to a vanilla MPI communicator
         operator MPI_Comm() const { return comm_; }
 
+        /// true for the communicator returned to ranks left out of a split()
+        bool is_null() const { return comm_==MPI_COMM_NULL; }
+
+        /// split into sub-communicators; ranks passing `MPI_UNDEFINED` as `color` get a null communicator
+        communicator split(int color, int key) const
+        {
+            MPI_Comm newcomm;
+            MPI_Comm_split(comm_, color, key, &newcomm);
+            return communicator(newcomm);
+        }
+
+        /// split into sub-communicators of the ranks that can share memory (i.e., run on the same node)
+        communicator split_shared(int key) const
+        {
+            MPI_Comm newcomm;
+            MPI_Comm_split_type(comm_, MPI_COMM_TYPE_SHARED, key, MPI_INFO_NULL, &newcomm);
+            return communicator(newcomm);
+        }
+
 
         int size() const
         {
@@ -129,4 +188,309 @@ namespace mpiwrap {
         std::swap(val, new_string);
     }
     
+
+
+    /// Packs values into a byte buffer, for a single broadcast
+    /**
+       Strings and vectors are stored with their sizes, trivially-copyable values
+       bytewise. Other classes must provide a member template visiting their fields:
+       @code
+       template <typename A> void serialize(A& ar) { ar & field1 & field2; }
+       @endcode
+       which is then used both by `packer` and `unpacker`.
+    */
+    class packer {
+        std::vector<char> buf_;
+
+        template <typename T>
+        void pack(const T& val, std::true_type /*trivially copyable*/)
+        {
+            const char* bytes=reinterpret_cast<const char*>(&val);
+            buf_.insert(buf_.end(), bytes, bytes+sizeof(T));
+        }
+
+        template <typename T>
+        void pack(const T& val, std::false_type /*trivially copyable*/)
+        {
+            const_cast<T&>(val).serialize(*this); // serialize() only reads the fields when packing
+        }
+
+      public:
+        template <typename T>
+        packer& operator&(const T& val)
+        {
+            pack(val, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+            return *this;
+        }
+
+        packer& operator&(const std::string& val)
+        {
+            *this & static_cast<unsigned long>(val.size());
+            buf_.insert(buf_.end(), val.begin(), val.end());
+            return *this;
+        }
+
+        template <typename T>
+        packer& operator&(const std::vector<T>& val)
+        {
+            *this & static_cast<unsigned long>(val.size());
+            for (const auto& elem: val) *this & elem;
+            return *this;
+        }
+
+        const std::vector<char>& buffer() const { return buf_; }
+    };
+
+
+    /// Unpacks values from a buffer made by `packer`, in the same order
+    class unpacker {
+        const std::vector<char>& buf_;
+        std::size_t pos_;
+
+        template <typename T>
+        void unpack(T& val, std::true_type /*trivially copyable*/)
+        {
+            if (sizeof(T)>buf_.size()-pos_) throw std::runtime_error("unpacker: corrupted buffer");
+            std::copy_n(buf_.data()+pos_, sizeof(T), reinterpret_cast<char*>(&val));
+            pos_+=sizeof(T);
+        }
+
+        template <typename T>
+        void unpack(T& val, std::false_type /*trivially copyable*/)
+        {
+            val.serialize(*this);
+        }
+
+        std::size_t unpack_size()
+        {
+            unsigned long size;
+            *this & size;
+            if (size>buf_.size()-pos_) throw std::runtime_error("unpacker: corrupted buffer");
+            return size;
+        }
+
+      public:
+        explicit unpacker(const std::vector<char>& buf, std::size_t pos=0): buf_(buf), pos_(pos) {}
+
+        template <typename T>
+        unpacker& operator&(T& val)
+        {
+            unpack(val, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+            return *this;
+        }
+
+        unpacker& operator&(std::string& val)
+        {
+            const std::size_t size=unpack_size();
+            val.assign(buf_.data()+pos_, size);
+            pos_+=size;
+            return *this;
+        }
+
+        template <typename T>
+        unpacker& operator&(std::vector<T>& val)
+        {
+            val.resize(unpack_size());
+            for (auto& elem: val) *this & elem;
+            return *this;
+        }
+    };
+
+
+    /// Broadcast a value of any type supported by `packer`, normally in a single collective call
+    /**
+       The packed value is broadcast in a chunk of a fixed size, prefixed by the total
+       size; only a value larger than the chunk needs a second collective for the rest.
+    */
+    template <typename T>
+    inline void bcast_packed(const communicator& comm, T& val, int root)
+    {
+        const std::size_t chunk=4096;
+        const std::size_t header=sizeof(unsigned long);
+        std::vector<char> buf;
+        if (comm.rank()==root) {
+            packer p;
+            p & static_cast<unsigned long>(0) & val;
+            buf=p.buffer();
+            const unsigned long total=buf.size();
+            std::copy_n(reinterpret_cast<const char*>(&total), header, buf.begin());
+        }
+        buf.resize(std::max(buf.size(), chunk));
+        MPI_Bcast(buf.data(), chunk, MPI_BYTE, root, comm);
+
+        unsigned long total;
+        std::copy_n(buf.begin(), header, reinterpret_cast<char*>(&total));
+        if (total>chunk) {
+            buf.resize(total);
+            MPI_Bcast(buf.data()+chunk, total-chunk, MPI_BYTE, root, comm);
+        }
+        if (comm.rank()!=root) {
+            unpacker u(buf, header);
+            u & val;
+        }
+    }
+
+
+    /// Wall-clock time in seconds
+    inline double wtime()
+    {
+        return MPI_Wtime();
+    }
+
+
+    namespace detail {
+        /// Maps a C++ arithmetic type to the corresponding MPI datatype
+        template <typename T> struct mpi_type;
+
+        template <> struct mpi_type<char> { static MPI_Datatype get() { return MPI_CHAR; } };
+        template <> struct mpi_type<int> { static MPI_Datatype get() { return MPI_INT; } };
+        template <> struct mpi_type<unsigned int> { static MPI_Datatype get() { return MPI_UNSIGNED; } };
+        template <> struct mpi_type<long> { static MPI_Datatype get() { return MPI_LONG; } };
+        template <> struct mpi_type<unsigned long> { static MPI_Datatype get() { return MPI_UNSIGNED_LONG; } };
+        template <> struct mpi_type<long long> { static MPI_Datatype get() { return MPI_LONG_LONG; } };
+        template <> struct mpi_type<unsigned long long> { static MPI_Datatype get() { return MPI_UNSIGNED_LONG_LONG; } };
+        template <> struct mpi_type<double> { static MPI_Datatype get() { return MPI_DOUBLE; } };
+    }
+
+
+    /// Reduce a single value over the communicator, the result is available on all ranks
+    template <typename T>
+    inline T all_reduce(const communicator& comm, const T& val, MPI_Op op)
+    {
+        T result;
+        MPI_Allreduce(&val, &result, 1, detail::mpi_type<T>::get(), op, comm);
+        return result;
+    }
+
+
+    /// Exclusive prefix reduction over the ranks; rank 0 receives a value-initialized `T`
+    template <typename T>
+    inline T exscan(const communicator& comm, const T& val, MPI_Op op)
+    {
+        T result=T();
+        MPI_Exscan(&val, &result, 1, detail::mpi_type<T>::get(), op, comm);
+        if (comm.rank()==0) result=T();
+        return result;
+    }
+
+
+    /// Gather a single value from every rank, the result is available on all ranks
+    template <typename T>
+    inline std::vector<T> all_gather(const communicator& comm, const T& val)
+    {
+        std::vector<T> result(comm.size());
+        MPI_Allgather(&val, 1, detail::mpi_type<T>::get(),
+                      result.data(), 1, detail::mpi_type<T>::get(), comm);
+        return result;
+    }
+
+
+    /// Gather a string from every rank; the result is available on the `root` only
+    inline std::vector<std::string> gather(const communicator& comm, const std::string& val, int root)
+    {
+        const int len=val.size();
+        std::vector<int> lens(comm.rank()==root? comm.size() : 0);
+        MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, root, comm);
+
+        std::vector<int> displs(lens.size(), 0);
+        for (std::size_t i=1; i<lens.size(); ++i) displs[i]=displs[i-1]+lens[i-1];
+        std::string all(lens.empty()? 0 : displs.back()+lens.back(), '\0');
+        MPI_Gatherv(const_cast<char*>(val.data()), len, MPI_CHAR,
+                    &all[0], lens.data(), displs.data(), MPI_CHAR, root, comm);
+
+        std::vector<std::string> result;
+        for (std::size_t i=0; i<lens.size(); ++i) result.push_back(all.substr(displs[i], lens[i]));
+        return result;
+    }
+
+
+    /// Name of the node this process runs on
+    inline std::string processor_name()
+    {
+        char name[MPI_MAX_PROCESSOR_NAME];
+        int len;
+        MPI_Get_processor_name(name, &len);
+        return std::string(name, len);
+    }
+
+
+    /// Version string of the MPI library (its first line)
+    inline std::string library_version()
+    {
+        char version[MPI_MAX_LIBRARY_VERSION_STRING];
+        int len;
+        MPI_Get_library_version(version, &len);
+        std::string first_line(version); // some implementations count the terminating null in `len`
+        first_line=first_line.substr(0, first_line.find_first_of("\r\n"));
+        return first_line.substr(0, first_line.find_last_not_of(" \t")+1);
+    }
+
+
+    /// The MPI-IO hints in effect for the file `path`, as `key=value` pairs
+    /**
+       Collective. The file is opened read-only with the hints `info` (by default, none), so the
+       result shows what the MPI-IO layer chose for this file system and this communicator.
+    */
+    inline std::vector<std::string> file_hints(const communicator& comm, const std::string& path,
+                                               MPI_Info info_in=MPI_INFO_NULL)
+    {
+        std::vector<std::string> hints;
+        MPI_File fh;
+        if (MPI_File_open(comm, const_cast<char*>(path.c_str()), MPI_MODE_RDONLY, info_in, &fh)!=MPI_SUCCESS) {
+            return hints;
+        }
+        MPI_Info info;
+        MPI_File_get_info(fh, &info);
+        int nkeys=0;
+        MPI_Info_get_nkeys(info, &nkeys);
+        for (int i=0; i<nkeys; ++i) {
+            char key[MPI_MAX_INFO_KEY+1];
+            char value[MPI_MAX_INFO_VAL+1];
+            int flag=0;
+            MPI_Info_get_nthkey(info, i, key);
+            MPI_Info_get(info, key, MPI_MAX_INFO_VAL, value, &flag);
+            if (flag) hints.push_back(std::string(key)+"="+value);
+        }
+        MPI_Info_free(&info);
+        MPI_File_close(&fh);
+        return hints;
+    }
+
+
+    /// MPI-3 shared-memory window of `T` values, allocated by rank 0 and directly accessible by all ranks
+    template <typename T>
+    class shared_window {
+        MPI_Win win_;
+        T* base_;
+      public:
+        /// collectively allocate `count` values; `comm` must be a shared-memory communicator
+        shared_window(const communicator& comm, std::size_t count)
+        {
+            const MPI_Aint nbytes= (comm.rank()==0)? count*sizeof(T) : 0;
+            void* my_ptr;
+            MPI_Win_allocate_shared(nbytes, sizeof(T), MPI_INFO_NULL, comm, &my_ptr, &win_);
+            MPI_Aint root_nbytes;
+            int disp_unit;
+            MPI_Win_shared_query(win_, 0, &root_nbytes, &disp_unit, &base_);
+        }
+
+        shared_window(const shared_window&) =delete;
+        shared_window& operator=(const shared_window&) =delete;
+
+        ~shared_window()
+        {
+            int flag;
+            MPI_Finalized(&flag);
+            if (!flag) MPI_Win_free(&win_);
+        }
+
+        /// pointer to the start of the window, valid on every rank
+        T* data() const { return base_; }
+
+        /// collective synchronization: stores made before are visible to all ranks after
+        void fence() const
+        {
+            MPI_Win_fence(0, win_);
+        }
+    };
 }
@@ -0,0 +1,133 @@
+/** @file drivers.hpp
+    The parallel file drivers of HDF5, chosen at run time among those the linked library provides
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+#include <mpi.h>
+#include <hdf5.h>
+#include <cmdline/cmdline.hpp>
+
+namespace drivers {
+
+    /// A parallel file driver and its parameters
+    struct config {
+        std::string name;          ///< "mpio" or "subfiling"
+        std::size_t subfiles;      ///< the number of subfiles a file is striped over (subfiling); 0 for the default
+        std::size_t stripe_size;   ///< the bytes of a stripe, written to one subfile (subfiling); 0 for the default
+
+        /// Visits the fields, to broadcast the parameters in one message
+        template <typename A>
+        void serialize(A& ar) { ar & name & subfiles & stripe_size; }
+    };
+
+    /// The names of the drivers provided by the linked HDF5
+    inline std::vector<std::string> available()
+    {
+        std::vector<std::string> names={"mpio"};
+#ifdef H5_HAVE_SUBFILING_VFD
+        names.push_back("subfiling");
+#endif
+        return names;
+    }
+
+    inline bool is_available(const std::string& name)
+    {
+        for (const auto& n: available()) {
+            if (n==name) return true;
+        }
+        return false;
+    }
+
+    /// The thread support that the driver `name` needs from MPI
+    inline int thread_level(const std::string& name)
+    {
+        // the subfiling driver forwards the I/O to its I/O concentrator threads
+        return name=="subfiling"? MPI_THREAD_MULTIPLE : MPI_THREAD_SINGLE;
+    }
+
+    /// The thread support needed by the drivers named in a `vfd=` argument (possibly a sweep), at least `level`
+    /**
+       To be called before MPI is initialized, so the command line is not parsed yet.
+    */
+    inline int thread_level(int argc, const char* const* argv, int level)
+    {
+        for (int i=1; i<argc; ++i) {
+            if (std::strncmp(argv[i], "vfd=", 4)!=0) continue;
+            const std::string names=argv[i]+4;
+            for (const auto& name: available()) {
+                if (names.find(name)!=std::string::npos) level=std::max(level, thread_level(name));
+            }
+        }
+        return level;
+    }
+
+
+    /// Reads the parameters `vfd`, `subfiles` and `subfile_stripe`; empty (after printing the reason) if invalid
+    inline program_options::optional<config> get_config(const program_options::params_map& par)
+    {
+        const program_options::optional<config> empty;
+        auto maybe_vfd = par.get_or("vfd", "mpio");
+        if (!maybe_vfd || (*maybe_vfd!="mpio" && *maybe_vfd!="subfiling")) {
+            std::cerr << "vfd parameter is invalid\n";
+            return empty;
+        }
+        if (!is_available(*maybe_vfd)) {
+            std::cerr << "The " << *maybe_vfd << " driver is not provided by this HDF5 (available:";
+            for (const auto& name: available()) std::cerr << " " << name;
+            std::cerr << ")\n";
+            return empty;
+        }
+
+        auto maybe_subfiles = par.get_or<std::size_t>("subfiles", 0);
+        if (!maybe_subfiles) {
+            std::cerr << "subfiles parameter is invalid\n";
+            return empty;
+        }
+
+        auto maybe_stripe = par.get_or<std::size_t>("subfile_stripe", 0);
+        if (!maybe_stripe) {
+            std::cerr << "subfile_stripe parameter is invalid\n";
+            return empty;
+        }
+
+        const config cfg={*maybe_vfd, *maybe_subfiles, *maybe_stripe};
+        return program_options::make_optional(cfg);
+    }
+
+
+    /// Sets the driver on the file access property list `fapl`, for the processes of `comm` with MPI-IO hints `info`
+    /**
+       The property list keeps copies of `comm` and `info`. Returns a negative value on failure.
+    */
+    inline herr_t set(hid_t fapl, const config& cfg, MPI_Comm comm, MPI_Info info)
+    {
+        if (cfg.name=="mpio") return H5Pset_fapl_mpio(fapl, comm, info);
+#ifdef H5_HAVE_SUBFILING_VFD
+        if (cfg.name=="subfiling") {
+            if (H5Pset_mpi_params(fapl, comm, info)<0) return -1;
+            // the defaults of the driver (and of its environment variables), with the requested changes
+            H5FD_subfiling_config_t sub;
+            if (H5Pget_fapl_subfiling(fapl, &sub)<0) return -1;
+            if (cfg.subfiles>0) sub.shared_cfg.stripe_count=static_cast<int32_t>(cfg.subfiles);
+            if (cfg.stripe_size>0) sub.shared_cfg.stripe_size=static_cast<int64_t>(cfg.stripe_size);
+            return H5Pset_fapl_subfiling(fapl, &sub);
+        }
+#endif
+        return -1;
+    }
+
+    /// The driver and its parameters, for the reports
+    inline std::string text(const config& cfg)
+    {
+        if (cfg.name!="subfiling") return cfg.name;
+        return cfg.name+" ("+(cfg.subfiles>0? std::to_string(cfg.subfiles) : std::string("default"))+" subfiles, "
+            +(cfg.stripe_size>0? std::to_string(cfg.stripe_size)+" B" : std::string("default"))+" stripes)";
+    }
+}
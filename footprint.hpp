@@ -0,0 +1,166 @@
+/** @file footprint.hpp
+    Memory consumed by each process and by the HDF5 library, reduced over the processes
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+
+#include <sys/resource.h>
+
+#include <hdf5.h>
+#include <mpiwrap/mpiwrap.hpp>
+
+#include "results.hpp"
+
+namespace footprint {
+
+    /// Resets the peak resident set size of this process (Linux only); false if it cannot be reset
+    inline bool reset_peak()
+    {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5" << std::endl;
+        return bool(clear_refs);
+    }
+
+    /// The memory of this process and of the HDF5 library, in MB; negative if unknown
+    struct sample {
+        double rss;            ///< resident set size
+        double peak_rss;       ///< peak resident set size since the last `reset_peak()` (or the start)
+        double h5_current;     ///< allocated by HDF5, if it is built with the memory allocation sanity checks
+        double h5_peak;
+        double h5_free_lists;  ///< held by the free lists of HDF5
+
+        static sample take()
+        {
+            const double mb=1024.*1024.;
+            sample s={-1., -1., -1., -1., -1.};
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            while (std::getline(status, line)) {
+                std::istringstream words(line);
+                std::string key;
+                double kb;
+                if (!(words >> key >> kb)) continue;
+                if (key=="VmRSS:") s.rss=kb/1024.;
+                if (key=="VmHWM:") s.peak_rss=kb/1024.;
+            }
+            if (s.peak_rss<0) {
+                struct rusage usage;
+                if (getrusage(RUSAGE_SELF, &usage)==0) s.peak_rss=usage.ru_maxrss/1024.;  // kB on Linux
+            }
+
+#if H5_VERSION_GE(1,10,7)
+            H5_alloc_stats_t stats;
+            if (H5get_alloc_stats(&stats)>=0 && stats.total_alloc_bytes>0) {
+                s.h5_current=stats.curr_alloc_bytes/mb;
+                s.h5_peak=stats.peak_alloc_bytes/mb;
+            }
+            size_t reg, arr, blk, fac;
+            if (H5get_free_list_sizes(&reg, &arr, &blk, &fac)>=0) s.h5_free_lists=(reg+arr+blk+fac)/mb;
+#endif
+            return s;
+        }
+    };
+
+    /// The metadata cache of an open file: its size in MB and its hit rate; negative if unknown
+    struct cache {
+        double max_size;
+        double size;
+        double hit_rate;
+
+        static cache of(hid_t file)
+        {
+            cache c={-1., -1., -1.};
+            size_t max_size, min_clean, cur_size;
+            int nentries;
+            if (H5Fget_mdc_size(file, &max_size, &min_clean, &cur_size, &nentries)>=0) {
+                c.max_size=max_size/(1024.*1024.);
+                c.size=cur_size/(1024.*1024.);
+            }
+            double rate;
+            if (H5Fget_mdc_hit_rate(file, &rate)>=0) c.hit_rate=rate;
+            return c;
+        }
+    };
+
+
+    /// A value over the processes: minimum, mean and maximum, and maximum over the aggregators
+    /**
+       The aggregators are the processes that transfer the data of others: the node leaders with
+       node aggregation, or, with collective I/O, the first process on each node (where ROMIO
+       places its collective buffering aggregators by default). Unknown (negative) values are
+       left out; all fields are negative if the value is unknown on all processes.
+    */
+    struct spread {
+        double min, mean, max, aggregators_max;
+
+        static spread reduce(const mpiwrap::communicator& comm, double value, bool is_aggregator)
+        {
+            const bool known= value>=0;
+            const int nknown=mpiwrap::all_reduce(comm, int(known), MPI_SUM);
+            if (nknown==0) return {-1., -1., -1., -1.};
+            spread s;
+            s.min=mpiwrap::all_reduce(comm, known? value : 1e300, MPI_MIN);
+            s.max=mpiwrap::all_reduce(comm, known? value : -1., MPI_MAX);
+            s.mean=mpiwrap::all_reduce(comm, known? value : 0., MPI_SUM)/nknown;
+            s.aggregators_max=mpiwrap::all_reduce(comm, known && is_aggregator? value : -1., MPI_MAX);
+            return s;
+        }
+
+        std::string text(int precision=1) const
+        {
+            if (max<0) return "n/a";
+            std::ostringstream strm;
+            strm << std::fixed << std::setprecision(precision) << min << "/" << mean << "/" << max;
+            if (aggregators_max>=0) strm << " [" << aggregators_max << "]";
+            return strm.str();
+        }
+
+        void add_to(results::record& rec, const std::string& key) const
+        {
+            rec.add(key+"_min", min)
+               .add(key+"_mean", mean)
+               .add(key+"_max", max)
+               .add(key+"_aggregators_max", aggregators_max);
+        }
+    };
+
+
+    /// The memory footprint of a benchmark run, reduced over the processes
+    class report {
+        std::vector< std::pair<std::string, spread> > items_;
+        int naggregators_=0;
+
+      public:
+        report() {}
+
+        /// Collective; `is_aggregator` tells whether this process is one of the aggregators
+        report(const mpiwrap::communicator& comm, bool is_aggregator)
+            : naggregators_(mpiwrap::all_reduce(comm, int(is_aggregator), MPI_SUM)) {}
+
+        /// Adds a reduced value, named as in the results records
+        void add(const std::string& key, const spread& s) { items_.push_back({key, s}); }
+
+        /// One line per value, for humans
+        void print(std::ostream& os) const
+        {
+            os << "memory (min/mean/max over the processes [max over the " << naggregators_ << " aggregators]):\n";
+            for (const auto& item: items_) {
+                os << "  " << std::left << std::setw(24) << item.first << std::right
+                   << item.second.text(item.first.find("rate")==std::string::npos? 1 : 3) << "\n";
+            }
+            os.flush();
+        }
+
+        void add_to(results::record& rec) const
+        {
+            rec.add("aggregators", naggregators_);
+            for (const auto& item: items_) item.second.add_to(rec, item.first);
+        }
+    };
+}
@@ -5,13 +5,169 @@
 
 #include <memory>
 #include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sstream>
 
 #include <hdf5.h>
 
 namespace h5 {
 
+    /// Opt-in tracing of the HDF5 calls made through this interface
+    /**
+       When enabled, each file and dataset create, open, close, read and write made through
+       the functions below (and the closing of file and dataset wrappers) is recorded into a
+       per-process ring buffer of fixed capacity, so that tracing allocates nothing while the
+       benchmark runs, and the oldest calls are dropped if the buffer overflows. When disabled,
+       a call costs a single test. Not thread-safe: the calls are expected from one thread.
+    */
+    namespace trace {
+
+        /// One traced call
+        struct event {
+            const char* op;      ///< the HDF5 function
+            double start;        ///< seconds since the start of the clock of `now()`
+            double duration;     ///< seconds
+            hsize_t bytes;       ///< bytes transferred by a read or a write
+            hsize_t elements;    ///< elements of the file selection of a read or a write
+            hssize_t blocks;     ///< hyperslab blocks of the file selection, -1 unless a hyperslab
+            int selection;       ///< type of the file selection (`H5S_sel_type`), -1 unless a read or a write
+            int mode;            ///< requested transfer mode (`H5FD_mpio_xfer_t`), -1 if not parallel
+            int actual;          ///< transfer mode actually used (`H5D_mpio_actual_io_mode_t`), -1 if unknown
+        };
+
+        /// The ring buffer of the traced calls of this process
+        class recorder {
+            std::vector<event> ring_;
+            std::size_t next_=0;
+            std::size_t total_=0;
+
+          public:
+            /// Starts recording, into a buffer of `capacity` calls
+            void enable(std::size_t capacity)
+            {
+                ring_.assign(capacity, event());
+                next_=total_=0;
+            }
+
+            bool enabled() const { return !ring_.empty(); }
+
+            void record(const event& e)
+            {
+                ring_[next_]=e;
+                next_=(next_+1)%ring_.size();
+                ++total_;
+            }
+
+            /// the recorded calls, oldest first
+            std::vector<event> events() const
+            {
+                if (total_<ring_.size()) return std::vector<event>(ring_.begin(), ring_.begin()+total_);
+                std::vector<event> out(ring_.begin()+next_, ring_.end());
+                out.insert(out.end(), ring_.begin(), ring_.begin()+next_);
+                return out;
+            }
+
+            /// the number of calls overwritten by newer ones
+            std::size_t dropped() const { return total_>ring_.size()? total_-ring_.size() : 0; }
+        };
+
+        /// The recorder of this process
+        inline recorder& global()
+        {
+            static recorder rec;
+            return rec;
+        }
+
+        inline bool enabled() { return global().enabled(); }
+
+        /// Seconds on a monotonic clock
+        inline double now()
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /// Records a call other than a transfer
+        inline void record(const char* op, double start, double end)
+        {
+            global().record({op, start, end-start, 0, 0, -1, -1, -1, -1});
+        }
+
+        namespace detail {
+            inline const char* selection_name(int sel)
+            {
+                switch (sel) {
+                  case H5S_SEL_NONE: return "none";
+                  case H5S_SEL_POINTS: return "points";
+                  case H5S_SEL_HYPERSLABS: return "hyperslabs";
+                  case H5S_SEL_ALL: return "all";
+                  default: return "";
+                }
+            }
+
+            inline const char* mode_name(int mode)
+            {
+                switch (mode) {
+                  case H5FD_MPIO_INDEPENDENT: return "independent";
+                  case H5FD_MPIO_COLLECTIVE: return "collective";
+                  default: return "";
+                }
+            }
+
+            inline const char* actual_name(int actual)
+            {
+                switch (actual) {
+                  case H5D_MPIO_NO_COLLECTIVE: return "independent";
+                  case H5D_MPIO_CHUNK_INDEPENDENT: return "independent chunks";
+                  case H5D_MPIO_CHUNK_COLLECTIVE: return "collective chunks";
+                  case H5D_MPIO_CHUNK_MIXED: return "mixed chunks";
+                  case H5D_MPIO_CONTIGUOUS_COLLECTIVE: return "collective";
+                  default: return "";
+                }
+            }
+        }
+
+        /// The calls as Chrome trace events (the `traceEvents` of chrome://tracing or Perfetto) of the process `pid`
+        /**
+           The times are in microseconds since `t0` (a time of `now()`), and the events are
+           separated by commas, so that the events of several processes can be concatenated.
+        */
+        inline std::string chrome_events(const std::vector<event>& events, int pid, double t0)
+        {
+            std::ostringstream out;
+            out.precision(15);
+            out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+                << ",\"args\":{\"name\":\"rank " << pid << "\"}}";
+            for (const auto& e: events) {
+                out << ",\n{\"name\":\"" << e.op << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":0"
+                    << ",\"ts\":" << (e.start-t0)*1e6 << ",\"dur\":" << e.duration*1e6;
+                if (e.selection>=0) {
+                    out << ",\"args\":{\"bytes\":" << e.bytes
+                        << ",\"elements\":" << e.elements
+                        << ",\"selection\":\"" << detail::selection_name(e.selection) << "\"";
+                    if (e.blocks>=0) out << ",\"blocks\":" << e.blocks;
+                    if (e.mode>=0) out << ",\"mode\":\"" << detail::mode_name(e.mode) << "\"";
+                    if (e.actual>=0) out << ",\"actual\":\"" << detail::actual_name(e.actual) << "\"";
+                    out << "}";
+                }
+                out << "}";
+            }
+            return out.str();
+        }
+    }
+
     namespace detail {
 
+        /// The name of a closing function to trace, or null for the resources that are not traced
+        inline const char* traced_closer(herr_t (*closer)(hid_t))
+        {
+            if (closer==&H5Fclose) return "H5Fclose";
+            if (closer==&H5Dclose) return "H5Dclose";
+            return nullptr;
+        }
+
         template <typename H5T, herr_t (*CLOSER_F)(H5T)>
         class wrapper_helper {
             typedef H5T h5_id_type;
@@ -21,7 +177,10 @@ namespace h5 {
 
             static void close_(h5_id_type id) {
                 if (id<0) return;
+                const char* traced= trace::enabled()? traced_closer(CLOSER_F) : nullptr;
+                const double t0= traced? trace::now() : 0.;
                 auto err=CLOSER_F(id);
+                if (traced) trace::record(traced, t0, trace::now());
                 // std::cerr << "DEBUG: resource with id=" << id << " destroyed, err=" << err << "\n";
                 if (err<0) {
                     throw std::runtime_error("Error freeing an HDF5 resource");
@@ -64,8 +223,134 @@ namespace h5 {
     using dspace_wrapper=detail::wrapper_helper<hid_t, H5Sclose>;
     using dset_wrapper=detail::wrapper_helper<hid_t, H5Dclose>;
     using plist_wrapper=detail::wrapper_helper<hid_t, H5Pclose>;
+    using type_wrapper=detail::wrapper_helper<hid_t, H5Tclose>;
 
     inline void check_error(herr_t err) {
         if (err<0) throw std::runtime_error("HDF5 call failed");
     }
+
+    /// Times a call to an HDF5 function `op` returning an id or a status, if tracing is enabled
+    template <typename F>
+    inline auto traced(const char* op, F call) -> decltype(call())
+    {
+        if (!trace::enabled()) return call();
+        const double t0=trace::now();
+        const auto ret=call();
+        trace::record(op, t0, trace::now());
+        return ret;
+    }
+
+    /// `H5Fcreate()`, traced
+    inline hid_t create_file(const std::string& name, unsigned flags, hid_t fcpl, hid_t fapl)
+    {
+        return traced("H5Fcreate", [&]() { return H5Fcreate(name.c_str(), flags, fcpl, fapl); });
+    }
+
+    /// `H5Fopen()`, traced
+    inline hid_t open_file(const std::string& name, unsigned flags, hid_t fapl)
+    {
+        return traced("H5Fopen", [&]() { return H5Fopen(name.c_str(), flags, fapl); });
+    }
+
+    /// `H5Dcreate2()`, traced
+    inline hid_t create_dataset(hid_t loc, const std::string& name, hid_t type, hid_t space,
+                                hid_t lcpl, hid_t dcpl, hid_t dapl)
+    {
+        return traced("H5Dcreate", [&]() { return H5Dcreate2(loc, name.c_str(), type, space, lcpl, dcpl, dapl); });
+    }
+
+    /// `H5Dopen2()`, traced
+    inline hid_t open_dataset(hid_t loc, const std::string& name, hid_t dapl)
+    {
+        return traced("H5Dopen", [&]() { return H5Dopen2(loc, name.c_str(), dapl); });
+    }
+
+    namespace detail {
+        /// Times a read or a write, and records its selection and transfer mode
+        template <typename F>
+        inline herr_t traced_transfer(const char* op, hid_t dset, hid_t mem_type, hid_t file_space, hid_t xfer, F call)
+        {
+            if (!trace::enabled()) return call();
+            trace::event e={op, 0., 0., 0, 0, -1, -1, -1, -1};
+            const hid_t space= file_space==H5S_ALL? H5Dget_space(dset) : file_space;
+            if (space>=0) {
+                e.selection=H5Sget_select_type(space);
+                const hssize_t n=H5Sget_select_npoints(space);
+                e.elements= n>0? n : 0;
+                if (e.selection==H5S_SEL_HYPERSLABS) e.blocks=H5Sget_select_hyper_nblocks(space);
+                if (space!=file_space) H5Sclose(space);
+            }
+            e.bytes=e.elements*H5Tget_size(mem_type);
+            H5FD_mpio_xfer_t mode;
+            if (xfer!=H5P_DEFAULT && H5Pget_dxpl_mpio(xfer, &mode)>=0) e.mode=mode;
+
+            e.start=trace::now();
+            const herr_t err=call();
+            e.duration=trace::now()-e.start;
+
+            H5D_mpio_actual_io_mode_t actual;
+            if (xfer!=H5P_DEFAULT && H5Pget_mpio_actual_io_mode(xfer, &actual)>=0) e.actual=actual;
+            trace::global().record(e);
+            return err;
+        }
+    }
+
+    /// `H5Dwrite()`, traced
+    inline herr_t write(hid_t dset, hid_t mem_type, hid_t mem_space, hid_t file_space, hid_t xfer, const void* buf)
+    {
+        return detail::traced_transfer("H5Dwrite", dset, mem_type, file_space, xfer, [&]() {
+            return H5Dwrite(dset, mem_type, mem_space, file_space, xfer, buf);
+        });
+    }
+
+    /// `H5Dread()`, traced
+    inline herr_t read(hid_t dset, hid_t mem_type, hid_t mem_space, hid_t file_space, hid_t xfer, void* buf)
+    {
+        return detail::traced_transfer("H5Dread", dset, mem_type, file_space, xfer, [&]() {
+            return H5Dread(dset, mem_type, mem_space, file_space, xfer, buf);
+        });
+    }
+
+    /// Describes the I/O mode actually used by the last parallel transfer with this property list
+    /**
+       A collective request may silently fall back to independent I/O (e.g., when
+       a datatype conversion is needed); HDF5 records the reasons in the property list.
+    */
+    inline std::string actual_io_mode(hid_t xfer_plist)
+    {
+        H5D_mpio_actual_io_mode_t mode;
+        uint32_t local_cause, global_cause;
+        check_error(H5Pget_mpio_actual_io_mode(xfer_plist, &mode));
+        check_error(H5Pget_mpio_no_collective_cause(xfer_plist, &local_cause, &global_cause));
+
+        std::string result="independent";
+        if (mode==H5D_MPIO_CONTIGUOUS_COLLECTIVE || mode==H5D_MPIO_CHUNK_COLLECTIVE) result="collective";
+        if (mode==H5D_MPIO_CHUNK_INDEPENDENT) result="independent chunks";
+        if (mode==H5D_MPIO_CHUNK_MIXED) result="mixed chunks";
+        if (global_cause==H5D_MPIO_COLLECTIVE) return result;
+
+        const struct { uint32_t bit; const char* what; } causes[]={
+            { H5D_MPIO_SET_INDEPENDENT, "independent I/O requested" },
+            { H5D_MPIO_DATATYPE_CONVERSION, "datatype conversion" },
+            { H5D_MPIO_DATA_TRANSFORMS, "data transforms" },
+            { H5D_MPIO_MPI_OPT_TYPES_ENV_VAR_DISABLED, "MPI derived types disabled" },
+            { H5D_MPIO_NOT_SIMPLE_OR_SCALAR_DATASPACES, "not simple or scalar dataspaces" },
+            { H5D_MPIO_NOT_CONTIGUOUS_OR_CHUNKED_DATASET, "neither contiguous nor chunked dataset" },
+            { H5D_MPIO_PARALLEL_FILTERED_WRITES_DISABLED, "parallel filtered writes disabled" }
+        };
+        result+=" (no collective I/O because of:";
+        for (const auto& c: causes) {
+            if (global_cause & c.bit) result+=std::string(" ")+c.what+";";
+        }
+        result+=")";
+        return result;
+    }
+
+    /// Version of the HDF5 library the program runs with, as "major.minor.release"
+    inline std::string library_version()
+    {
+        unsigned maj, min, rel;
+        check_error(H5get_libversion(&maj, &min, &rel));
+        return std::to_string(maj)+"."+std::to_string(min)+"."+std::to_string(rel);
+    }
 }
@@ -0,0 +1,140 @@
+/** @file h5_types.hpp
+    Element types of the benchmarks and their HDF5 memory and file types
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <hdf5.h>
+
+namespace h5 {
+
+    /// A particle record, as written by particle codes (no padding, to be compared bytewise)
+    struct particle {
+        double position[3];
+        float velocity[3];
+        std::int32_t species;
+        std::int64_t id;
+    };
+
+    namespace detail {
+        /// The byte order opposite to the native one
+        inline H5T_order_t swapped_order()
+        {
+            return (H5Tget_order(H5T_NATIVE_INT)==H5T_ORDER_LE)? H5T_ORDER_BE : H5T_ORDER_LE;
+        }
+
+        /// A copy of the native type `native`, in the opposite byte order if requested
+        inline hid_t scalar_type(hid_t native, bool swap_order)
+        {
+            hid_t type=H5Tcopy(native);
+            if (type>=0 && swap_order) H5Tset_order(type, swapped_order());
+            return type;
+        }
+    }
+
+    /// HDF5 types and test values for the C++ element type `T`
+    /**
+       `memory_type()` and `file_type()` return new type ids, to be closed by the caller
+       (e.g., by wrapping them into `h5::type_wrapper`). With `swap_order`, the file type
+       has the byte order opposite to the native one, which forces a conversion on
+       every transfer.
+    */
+    template <typename T> struct type_traits;
+
+    template <> struct type_traits<double> {
+        static const char* name() { return "double"; }
+        static hid_t memory_type() { return H5Tcopy(H5T_NATIVE_DOUBLE); }
+        static hid_t file_type(bool swap_order) { return detail::scalar_type(H5T_NATIVE_DOUBLE, swap_order); }
+        static double make(std::uint64_t x) { return double(x); }
+    };
+
+    template <> struct type_traits<float> {
+        static const char* name() { return "float"; }
+        static hid_t memory_type() { return H5Tcopy(H5T_NATIVE_FLOAT); }
+        static hid_t file_type(bool swap_order) { return detail::scalar_type(H5T_NATIVE_FLOAT, swap_order); }
+        static float make(std::uint64_t x) { return float(x); }
+    };
+
+    template <> struct type_traits<std::int32_t> {
+        static const char* name() { return "int32"; }
+        static hid_t memory_type() { return H5Tcopy(H5T_NATIVE_INT32); }
+        static hid_t file_type(bool swap_order) { return detail::scalar_type(H5T_NATIVE_INT32, swap_order); }
+        static std::int32_t make(std::uint64_t x) { return std::int32_t(x); }
+    };
+
+    template <> struct type_traits<std::int64_t> {
+        static const char* name() { return "int64"; }
+        static hid_t memory_type() { return H5Tcopy(H5T_NATIVE_INT64); }
+        static hid_t file_type(bool swap_order) { return detail::scalar_type(H5T_NATIVE_INT64, swap_order); }
+        static std::int64_t make(std::uint64_t x) { return std::int64_t(x); }
+    };
+
+    template <> struct type_traits<particle> {
+        static const char* name() { return "particle"; }
+        static hid_t memory_type() { return compound(false); }
+        static hid_t file_type(bool swap_order) { return compound(swap_order); }
+
+        static particle make(std::uint64_t x)
+        {
+            particle p;
+            for (int k=0; k<3; ++k) {
+                p.position[k]=double(x)+0.25*k;
+                p.velocity[k]=float(k)-0.5f;
+            }
+            p.species=std::int32_t(x%4);
+            p.id=std::int64_t(x);
+            return p;
+        }
+
+      private:
+        static hid_t compound(bool swap_order)
+        {
+            const hsize_t three=3;
+            hid_t type=H5Tcreate(H5T_COMPOUND, sizeof(particle));
+            hid_t f64=detail::scalar_type(H5T_NATIVE_DOUBLE, swap_order);
+            hid_t f32=detail::scalar_type(H5T_NATIVE_FLOAT, swap_order);
+            hid_t i32=detail::scalar_type(H5T_NATIVE_INT32, swap_order);
+            hid_t i64=detail::scalar_type(H5T_NATIVE_INT64, swap_order);
+            hid_t pos=H5Tarray_create(f64, 1, &three);
+            hid_t vel=H5Tarray_create(f32, 1, &three);
+            H5Tinsert(type, "position", HOFFSET(particle, position), pos);
+            H5Tinsert(type, "velocity", HOFFSET(particle, velocity), vel);
+            H5Tinsert(type, "species", HOFFSET(particle, species), i32);
+            H5Tinsert(type, "id", HOFFSET(particle, id), i64);
+            for (hid_t t: {pos, vel, f64, f32, i32, i64}) H5Tclose(t);
+            return type;
+        }
+    };
+
+    /// Compares two elements bytewise
+    template <typename T>
+    inline bool same_bytes(const T& a, const T& b)
+    {
+        return std::memcmp(&a, &b, sizeof(T))==0;
+    }
+
+    /// Calls `f.template run<T>()` with `T` being the element type named `type_name`; returns false for unknown names
+    template <typename F>
+    inline bool dispatch_type(const std::string& type_name, F& f)
+    {
+        if (type_name=="double") f.template run<double>();
+        else if (type_name=="float") f.template run<float>();
+        else if (type_name=="int32") f.template run<std::int32_t>();
+        else if (type_name=="int64") f.template run<std::int64_t>();
+        else if (type_name=="particle") f.template run<particle>();
+        else return false;
+        return true;
+    }
+
+    /// Whether `type_name` names an element type known to `dispatch_type()`
+    inline bool is_known_type(const std::string& type_name)
+    {
+        for (const char* known: {"double", "float", "int32", "int64", "particle"}) {
+            if (type_name==known) return true;
+        }
+        return false;
+    }
+}
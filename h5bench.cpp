@@ -0,0 +1,14 @@
+/** @file h5bench.cpp Writes data to the HDF5 file in any registered access pattern
+
+    The pattern (`pattern=rows`, `pattern=blocks`, ...) decides the extents of the dataset(s)
+    and the elements each process writes; the file setup, layout, MPI-IO hints, buffer
+    preparation, aggregation, timing, read-back and reporting are the same for all patterns.
+    Optionally, reads the data back in the same or another pattern and verifies it.
+ */
+
+#include "bench.hpp"
+
+int main(int argc, char** argv)
+{
+    return bench::run_program(argc, argv, "h5bench", "");
+}
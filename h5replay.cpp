@@ -0,0 +1,511 @@
+/** @file h5replay.cpp Replays an I/O trace: the file and dataset creates, reads and writes of an application
+
+    The trace (see `replay.hpp`) lists the hyperslabs each process reads and writes, step by step,
+    with the computation time between the steps. It is replayed through the same HDF5 path as
+    `h5bench`, on any number of processes (the selections of the processes that made the trace
+    are split or merged), and with the computation time scaled (or skipped).
+ */
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#include <mpiwrap/mpiwrap.hpp>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "h5_types.hpp"
+#include "parse_and_bcast.hpp"
+#include "results.hpp"
+#include "patterns.hpp"
+#include "replay.hpp"
+#include "bench.hpp"
+#include "drivers.hpp"
+
+namespace po=program_options;
+namespace mpi=mpiwrap;
+
+struct my_params {
+    std::string input;
+    std::string text;          ///< the contents of the trace
+    std::string file_name;     ///< replaces the file names of the trace, unless empty
+    bool do_collective;
+    std::string hints;
+    drivers::config vfd;
+    double timescale;
+    std::string trace_file;
+    std::size_t trace_events;
+    std::string results_file;
+    std::string results_format;
+
+    /// Visits the fields, to broadcast the parameters in one message
+    template <typename A>
+    void serialize(A& ar)
+    {
+        ar & input
+           & text
+           & file_name
+           & do_collective
+           & hints
+           & vfd
+           & timescale
+           & trace_file
+           & trace_events
+           & results_file
+           & results_format;
+    }
+};
+
+
+/// Parses and checks the parameters, and reads the trace
+po::optional<my_params> parse_params(int argc, const char* const* argv)
+{
+    const po::optional<my_params> empty;
+    auto par = po::parse(argc, argv);
+    if (!par || argc<2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " input=<trace_file> collective=<yes|no> [file=<file_name>]"
+                  << " [timescale=<computation_time_factor>] [hints=<key>=<value>:<key>=<value>...]"
+                  << " [vfd=<mpio|subfiling>] [subfiles=<number>] [subfile_stripe=<bytes>]"
+                  << " [trace=<file.json>] [tracebuf=<calls_per_process>]"
+                  << " [results=<file|->] [format=<csv|json>]"
+                  << std::endl;
+        return empty;
+    }
+
+    auto maybe_input = par->get<std::string>("input");
+    if (!maybe_input) {
+        std::cerr << "input parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_collective = par->get<bool>("collective");
+    if (!maybe_collective) {
+        std::cerr << "collective parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_file = par->get_or("file", "");
+    if (!maybe_file) {
+        std::cerr << "file parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_timescale = par->get_or("timescale", 1.);
+    if (!maybe_timescale || *maybe_timescale<0) {
+        std::cerr << "timescale parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_hints = par->get_or("hints", "");
+    std::vector< std::pair<std::string,std::string> > hint_pairs;
+    if (!maybe_hints || !bench::parse_hints(*maybe_hints, hint_pairs)) {
+        std::cerr << "hints parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_vfd = drivers::get_config(*par);
+    if (!maybe_vfd) return empty;
+
+    auto maybe_trace = par->get_or("trace", "");
+    if (!maybe_trace) {
+        std::cerr << "trace parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_tracebuf = par->get_or<std::size_t>("tracebuf", 65536);
+    if (!maybe_tracebuf || *maybe_tracebuf<1) {
+        std::cerr << "tracebuf parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_results = par->get_or("results", "");
+    if (!maybe_results) {
+        std::cerr << "results parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_format = par->get_or("format", "csv");
+    if (!maybe_format || (*maybe_format!="csv" && *maybe_format!="json")) {
+        std::cerr << "format parameter is invalid\n";
+        return empty;
+    }
+
+    std::ifstream in(*maybe_input);
+    if (!in) {
+        std::cerr << "Cannot read the trace " << *maybe_input << "\n";
+        return empty;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    std::istringstream check(text.str());
+    if (!replay::parse(check)) return empty;
+
+    const my_params my_par = {
+        *maybe_input,
+        text.str(),
+        *maybe_file,
+        *maybe_collective,
+        *maybe_hints,
+        *maybe_vfd,
+        *maybe_timescale,
+        *maybe_trace,
+        *maybe_tracebuf,
+        *maybe_results,
+        *maybe_format
+    };
+    return po::make_optional(my_par);
+}
+
+
+/// The part of the selection `sel` of the trace process `trank` (of `nranks`) replayed by the process `rank` (of `nprocs`)
+/**
+   The trace process `r` is replayed by the processes `r*nprocs/nranks` to `(r+1)*nprocs/nranks`
+   (exclusive), but at least by one. If several processes replay it, its selection is split
+   between them along the first dimension; if it is replayed by a process together with
+   other trace processes, their selections are merged.
+*/
+patterns::selection rescale(const patterns::selection& sel, int trank, int nranks, int rank, int nprocs)
+{
+    const int first=static_cast<long long>(trank)*nprocs/nranks;
+    const int last=std::max<int>(first+1, static_cast<long long>(trank+1)*nprocs/nranks);
+    if (rank<first || rank>=last) return patterns::selection::none(sel.ndims);
+    const hsize_t nparts=last-first, part=rank-first;
+    if (nparts==1) return sel;
+
+    patterns::selection piece=sel;
+    if (sel.count[0]>1) {
+        const hsize_t c0=patterns::part_start(sel.count[0], nparts, part);
+        piece.start[0]+=c0*sel.stride[0];
+        piece.count[0]=patterns::part_start(sel.count[0], nparts, part+1)-c0;
+    } else {
+        const hsize_t b0=patterns::part_start(sel.block[0], nparts, part);
+        piece.start[0]+=b0;
+        piece.block[0]=patterns::part_start(sel.block[0], nparts, part+1)-b0;
+    }
+    return piece.size()>0? piece : patterns::selection::none(sel.ndims);
+}
+
+
+/// The runs of the union of `sels` in a dataset of extents `dims`, in the file order (which HDF5 uses for a union)
+std::vector<patterns::run> union_runs(const std::vector<patterns::selection>& sels, const std::vector<hsize_t>& dims,
+                                      hsize_t& total)
+{
+    std::vector<patterns::run> all;
+    for (const auto& sel: sels) {
+        const auto runs=patterns::make_runs(sel, dims, 0, 0);
+        all.insert(all.end(), runs.begin(), runs.end());
+    }
+    std::sort(all.begin(), all.end(), [](const patterns::run& a, const patterns::run& b) { return a.pos<b.pos; });
+
+    std::vector<patterns::run> out;
+    for (const auto& r: all) {
+        const hsize_t end= out.empty()? 0 : out.back().pos+out.back().length;
+        if (!out.empty() && r.pos<=end) {
+            out.back().length=std::max(end, r.pos+r.length)-out.back().pos;
+        } else {
+            out.push_back(r);
+        }
+    }
+    total=0;
+    for (auto& r: out) {
+        r.buf=total;
+        total+=r.length;
+    }
+    return out;
+}
+
+
+/// A dataset of the open file, with its element type
+struct dataset {
+    std::unique_ptr<h5::dset_wrapper> id;
+    std::vector<hsize_t> dims;
+    std::string type_name;   ///< empty if the dataset was not created by the trace
+    std::unique_ptr<h5::type_wrapper> mem_type;
+    std::size_t elem_size;
+};
+
+/// The types of the elements chosen at run time
+struct type_runner {
+    hid_t mem_type;
+    hid_t file_type;
+    std::size_t size;
+
+    template <typename T>
+    void run()
+    {
+        mem_type=h5::type_traits<T>::memory_type();
+        file_type=h5::type_traits<T>::file_type(false);
+        size=sizeof(T);
+    }
+};
+
+/// Fills a buffer with the values of the runs, as `h5bench` does
+struct fill_runner {
+    std::vector<char>& buf;
+    const std::vector<patterns::run>& runs;
+
+    template <typename T>
+    void run()
+    {
+        hsize_t unused_size;
+        std::vector<T> unused;
+        bench::generate(reinterpret_cast<T*>(buf.data()), runs, bench::make_tasks(runs, 0, unused_size), unused, 1, 0);
+    }
+};
+
+
+/// The outcome of a replay
+struct replay_result {
+    std::size_t nsteps;
+    double write_time, read_time, gap_time, total_time;
+    double write_mbytes, read_mbytes;
+};
+
+
+/// Replays the trace `tr` on the processes of `comm`
+replay_result replay_trace(const replay::trace& tr, const my_params& par, const mpi::communicator& comm)
+{
+    const int rank=comm.rank(), nprocs=comm.size();
+    replay_result res={0, 0., 0., 0., 0., 0., 0.};
+    double my_write=0, my_read=0, my_gap=0;
+    hsize_t written=0, read=0;
+
+    std::unique_ptr<h5::fd_wrapper> file;
+    std::map<std::string, dataset> dsets;
+    auto xfer = h5::plist_wrapper(H5Pcreate(H5P_DATASET_XFER));
+    h5::check_error(H5Pset_dxpl_mpio(xfer, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT));
+
+    // the dataset, opened on first use if it was not created by the trace
+    auto get_dataset=[&](const std::string& name) -> dataset& {
+        auto& ds=dsets[name];
+        if (!ds.id) {
+            ds.id.reset(new h5::dset_wrapper(h5::open_dataset(*file, name, H5P_DEFAULT)));
+            auto space = h5::dspace_wrapper(H5Dget_space(*ds.id));
+            ds.dims.resize(H5Sget_simple_extent_ndims(space));
+            H5Sget_simple_extent_dims(space, ds.dims.data(), nullptr);
+            auto file_type = h5::type_wrapper(H5Dget_type(*ds.id));
+            ds.mem_type.reset(new h5::type_wrapper(H5Tget_native_type(file_type, H5T_DIR_ASCEND)));
+            ds.elem_size=H5Tget_size(*ds.mem_type);
+        }
+        return ds;
+    };
+
+    /*
+     * The transfers of a step: the selections of this process of each dataset, merged into
+     * one call per dataset. All processes make the calls in the same order, as collective
+     * transfers require.
+     */
+    std::vector< std::pair<replay::op::kind_type, std::string> > order;
+    std::map< std::pair<int, std::string>, std::vector<patterns::selection> > mine;
+
+    auto run_step=[&]() {
+        if (order.empty()) return;
+        struct prepared {
+            dataset* ds;
+            bool is_write;
+            std::unique_ptr<h5::dspace_wrapper> filespace, memspace;
+            std::vector<char> buf;
+            hsize_t count;
+        };
+        std::vector<prepared> calls(order.size());
+        for (std::size_t i=0; i<order.size(); ++i) {
+            auto& c=calls[i];
+            c.ds=&get_dataset(order[i].second);
+            c.is_write= order[i].first==replay::op::write;
+            const auto& sels=mine[{order[i].first, order[i].second}];
+            const auto runs=union_runs(sels, c.ds->dims, c.count);
+            c.filespace.reset(new h5::dspace_wrapper(H5Dget_space(*c.ds->id)));
+            h5::check_error(H5Sselect_none(*c.filespace));
+            for (const auto& sel: sels) sel.apply(*c.filespace, H5S_SELECT_OR);
+            c.memspace.reset(new h5::dspace_wrapper(bench::memory_space(c.count)));
+            c.buf.assign(std::max<hsize_t>(c.count, 1)*c.ds->elem_size, 0);
+            if (c.is_write && !c.ds->type_name.empty()) {
+                fill_runner fill={c.buf, runs};
+                h5::dispatch_type(c.ds->type_name, fill);
+            }
+        }
+
+        comm.barrier();
+        for (auto& c: calls) {
+            const double t0=mpi::wtime();
+            if (c.is_write) {
+                h5::check_error(h5::write(*c.ds->id, *c.ds->mem_type, *c.memspace, *c.filespace, xfer, c.buf.data()));
+                my_write+=mpi::wtime()-t0;
+                written+=c.count*c.ds->elem_size;
+            } else {
+                h5::check_error(h5::read(*c.ds->id, *c.ds->mem_type, *c.memspace, *c.filespace, xfer, c.buf.data()));
+                my_read+=mpi::wtime()-t0;
+                read+=c.count*c.ds->elem_size;
+            }
+        }
+        ++res.nsteps;
+        order.clear();
+        mine.clear();
+    };
+
+    MPI_Info info=bench::make_info(par.hints);
+    auto fapl = h5::plist_wrapper(H5Pcreate(H5P_FILE_ACCESS));
+    h5::check_error(drivers::set(fapl, par.vfd, comm, info));
+    if (info!=MPI_INFO_NULL) MPI_Info_free(&info);
+
+    comm.barrier();
+    const double t_start=mpi::wtime();
+    for (const auto& o: tr.ops) {
+        switch (o.kind) {
+          case replay::op::create_file:
+          case replay::op::open_file: {
+              const std::string name= par.file_name.empty()? o.name : par.file_name;
+              file.reset(new h5::fd_wrapper(o.kind==replay::op::create_file?
+                                            h5::create_file(name, H5F_ACC_TRUNC, H5P_DEFAULT, fapl) :
+                                            h5::open_file(name, H5F_ACC_RDWR, fapl)));
+              break;
+          }
+          case replay::op::close_file:
+              run_step();
+              dsets.clear();
+              file->close();
+              file.reset();
+              break;
+          case replay::op::create_dataset: {
+              run_step();
+              type_runner types={-1, -1, 0};
+              h5::dispatch_type(o.type_name, types);
+              auto file_type = h5::type_wrapper(types.file_type);
+              auto& ds=dsets[o.name];
+              ds.dims=o.dims;
+              ds.type_name=o.type_name;
+              ds.mem_type.reset(new h5::type_wrapper(types.mem_type));
+              ds.elem_size=types.size;
+              auto dcpl = h5::plist_wrapper(H5Pcreate(H5P_DATASET_CREATE));
+              if (!o.chunk.empty()) h5::check_error(H5Pset_chunk(dcpl, o.chunk.size(), o.chunk.data()));
+              auto space = h5::dspace_wrapper(H5Screate_simple(o.dims.size(), o.dims.data(), nullptr));
+              ds.id.reset(new h5::dset_wrapper(h5::create_dataset(*file, o.name, file_type, space,
+                                                                  H5P_DEFAULT, dcpl, H5P_DEFAULT)));
+              break;
+          }
+          case replay::op::step: {
+              run_step();
+              const double t0=mpi::wtime();
+              std::this_thread::sleep_for(std::chrono::duration<double>(o.gap*par.timescale));
+              my_gap+=mpi::wtime()-t0;
+              break;
+          }
+          case replay::op::write:
+          case replay::op::read: {
+              const std::pair<replay::op::kind_type, std::string> key(o.kind, o.name);
+              if (std::find(order.begin(), order.end(), key)==order.end()) order.push_back(key);
+              const auto piece=rescale(o.sel, o.rank, tr.nranks, rank, nprocs);
+              if (piece.size()>0) mine[{o.kind, o.name}].push_back(piece);
+              break;
+          }
+        }
+    }
+    res.total_time=mpi::all_reduce(comm, mpi::wtime()-t_start, MPI_MAX);
+    res.write_time=mpi::all_reduce(comm, my_write, MPI_MAX);
+    res.read_time=mpi::all_reduce(comm, my_read, MPI_MAX);
+    res.gap_time=mpi::all_reduce(comm, my_gap, MPI_MAX);
+    res.write_mbytes=mpi::all_reduce(comm, double(written), MPI_SUM)/(1024.*1024.);
+    res.read_mbytes=mpi::all_reduce(comm, double(read), MPI_SUM)/(1024.*1024.);
+    return res;
+}
+
+
+int main(int argc, char** argv)
+{
+    using std::cout;
+    using std::endl;
+
+    mpi::environment env(argc, argv, drivers::thread_level(argc, argv, MPI_THREAD_SINGLE));
+    mpi::communicator comm;
+    const int master=0;
+    bool is_master = comm.rank()==master;
+
+    const auto maybe_par = parse_and_bcast(comm, master, [&]() { return parse_params(argc, argv); });
+    if (!maybe_par) {
+        env.abort(3);
+        return 3;
+    }
+    const auto& par = *maybe_par;
+    if (env.thread_level()<drivers::thread_level(par.vfd.name)) {
+        if (is_master) std::cerr << "The " << par.vfd.name << " driver needs MPI_THREAD_MULTIPLE" << endl;
+        env.abort(3);
+        return 3;
+    }
+    std::istringstream text(par.text);
+    const auto tr=*replay::parse(text);
+
+    const auto info=results::run_info::collect(comm, master);
+    if (is_master) {
+        cout << "Running h5replay with input=" << par.input << " (" << tr.ops.size() << " operations of "
+             << tr.nranks << " processes) collective=" << std::boolalpha << par.do_collective
+             << " timescale=" << par.timescale << " hints=" << par.hints << " vfd=" << drivers::text(par.vfd)
+             << "\non " << info.summary()
+             << endl;
+    }
+
+    double t_sync=0;
+    if (!par.trace_file.empty()) {
+        h5::trace::global().enable(par.trace_events);
+        comm.barrier();
+        t_sync=h5::trace::now();
+    }
+
+    const auto res=replay_trace(tr, par, comm);
+
+    if (is_master) {
+        cout << std::fixed << std::setprecision(6)
+             << "replay: " << res.nsteps << " steps in " << res.total_time << " s, of which computation "
+             << res.gap_time << " s (timescale " << std::setprecision(2) << par.timescale << ")";
+        if (res.write_mbytes>0) {
+            cout << std::setprecision(6) << "\nwrite: time=" << res.write_time << " s, " << std::setprecision(2)
+                 << res.write_mbytes/res.write_time << " MB/s (" << res.write_mbytes << " MB)";
+        }
+        if (res.read_mbytes>0) {
+            cout << std::setprecision(6) << "\nread: time=" << res.read_time << " s, " << std::setprecision(2)
+                 << res.read_mbytes/res.read_time << " MB/s (" << res.read_mbytes << " MB)";
+        }
+        cout << std::defaultfloat << endl;
+    }
+
+    results::writer out(is_master? par.results_file : "", par.results_format);
+    int status=0;
+    if (is_master && out) {
+        results::record rec;
+        rec.add("program", "h5replay").add("date", results::utc_time())
+           .add("input", par.input)
+           .add("trace_ranks", tr.nranks)
+           .add("collective", par.do_collective)
+           .add("timescale", par.timescale)
+           .add("requested_hints", par.hints)
+           .add("vfd", par.vfd.name)
+           .add("subfiles", par.vfd.subfiles)
+           .add("subfile_stripe", par.vfd.stripe_size)
+           .add("steps", res.nsteps)
+           .add("total_s", res.total_time)
+           .add("compute_s", res.gap_time)
+           .add("write_MB", res.write_mbytes)
+           .add("write_s", res.write_time)
+           .add("write_MBps", res.write_mbytes/res.write_time)
+           .add("read_MB", res.read_mbytes)
+           .add("read_s", res.read_time)
+           .add("read_MBps", res.read_mbytes/res.read_time);
+        info.add_to(rec);
+        if (!out.write(rec)) {
+            std::cerr << "The columns of " << par.results_file << " differ from those of h5replay; the record is not written"
+                      << " (use format=json for records with different columns)\n";
+            status=3;
+        }
+    }
+
+    if (!par.trace_file.empty()) bench::write_trace(comm, master, par.trace_file, t_sync);
+    return status;
+}
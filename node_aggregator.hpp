@@ -0,0 +1,54 @@
+/** @file node_aggregator.hpp
+    Collects the data of all processes on a node in shared memory, to be written by one process per node
+*/
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <mpiwrap/mpiwrap.hpp>
+
+namespace aggregation {
+
+    /// Splits the processes by node and holds a node-wide shared-memory buffer of `T` elements
+    /**
+       The processes of a node are ordered as in the parent communicator; the node's
+       rank 0 is the "leader". The leaders form a cross-node communicator, over which
+       they write the whole node's data. Every process places its data directly into
+       the node buffer, so no extra copy is made.
+    */
+    template <typename T>
+    class node_aggregator {
+        mpiwrap::communicator node_;
+        mpiwrap::communicator leaders_;
+        std::vector<int> members_;
+        mpiwrap::shared_window<T> window_;
+
+      public:
+        /// collectively create the node groups and a buffer for `count_per_proc` elements per process
+        node_aggregator(const mpiwrap::communicator& comm, std::size_t count_per_proc)
+            : node_(comm.split_shared(comm.rank())),
+              leaders_(comm.split(node_.rank()==0? 0 : MPI_UNDEFINED, comm.rank())),
+              members_(mpiwrap::all_gather(node_, comm.rank())),
+              window_(node_, count_per_proc*node_.size())
+        { }
+
+        /// the processes on this node
+        const mpiwrap::communicator& node() const { return node_; }
+
+        /// whether this process writes on behalf of its node
+        bool is_leader() const { return node_.rank()==0; }
+
+        /// cross-node communicator of the leaders (null on the other processes)
+        const mpiwrap::communicator& leaders() const { return leaders_; }
+
+        /// ranks of the node's processes in the parent communicator, in ascending order
+        const std::vector<int>& members() const { return members_; }
+
+        /// the node-wide buffer, accessible by all processes of the node
+        T* buffer() const { return window_.data(); }
+
+        /// make the data placed into the buffer by all processes of the node visible to the leader
+        void sync() const { window_.fence(); }
+    };
+}
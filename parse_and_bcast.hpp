@@ -0,0 +1,45 @@
+/** @file parse_and_bcast.hpp
+    Parsing the parameters on one process and broadcasting them to all processes
+*/
+#pragma once
+
+#include <type_traits>
+
+#include <cmdline/cmdline.hpp>
+#include <mpiwrap/mpiwrap.hpp>
+
+namespace detail {
+    /// The outcome of parsing, as broadcast
+    template <typename T>
+    struct parsed_params {
+        bool ok;
+        T value;
+
+        template <typename A>
+        void serialize(A& ar) { ar & ok & value; }
+    };
+}
+
+
+/// Calls `parse()` on the `root` and broadcasts the parameters to all processes in one collective
+/**
+   `parse()` returns `program_options::optional<T>`, empty if the parameters are invalid
+   (after printing the reason). `T` is packed by `mpiwrap::packer`, so a parameter struct
+   needs a `serialize()` member template. The result is empty on all processes
+   if it is empty on the root.
+*/
+template <typename F>
+auto parse_and_bcast(const mpiwrap::communicator& comm, int root, F parse) -> decltype(parse())
+{
+    typedef decltype(parse()) result_type;
+    typedef typename std::decay<decltype(*parse())>::type value_type;
+
+    detail::parsed_params<value_type> msg{false, value_type()};
+    if (comm.rank()==root) {
+        const auto maybe_par=parse();
+        msg.ok=bool(maybe_par);
+        if (msg.ok) msg.value=*maybe_par;
+    }
+    mpiwrap::bcast_packed(comm, msg, root);
+    return msg.ok? program_options::make_optional(msg.value) : result_type();
+}
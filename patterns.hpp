@@ -0,0 +1,946 @@
+/** @file patterns.hpp
+    Access patterns of `h5bench`: the extents of the dataset(s) and the elements each process accesses
+*/
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <iostream>
+
+#include <mpi.h>
+#include <hdf5.h>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "results.hpp"
+#include "slabs.hpp"
+
+namespace patterns {
+
+    using slabs::part_start;
+
+    /// Parses extents such as `256x256`, each at least `min_extent`; empty if invalid
+    inline std::vector<hsize_t> parse_extents(const std::string& s, hsize_t min_extent=1)
+    {
+        std::vector<hsize_t> extents;
+        std::string::size_type pos=0;
+        while (true) {
+            const auto x=s.find('x', pos);
+            auto maybe_extent=program_options::detail::try_lexical_cast<hsize_t>(
+                s.substr(pos, x==std::string::npos? std::string::npos : x-pos));
+            if (!maybe_extent || *maybe_extent<min_extent) return {};
+            extents.push_back(*maybe_extent);
+            if (x==std::string::npos) break;
+            pos=x+1;
+        }
+        return extents;
+    }
+
+
+    /// Elements of a dataset accessed by one process: a regular hyperslab or a list of points
+    struct selection {
+        std::size_t ndims;
+        bool is_points;
+        std::vector<hsize_t> start, stride, count, block;  ///< the hyperslab, as for `H5Sselect_hyperslab()`
+        std::vector<hsize_t> coords;  ///< the points, `ndims` coordinates each, in the buffer order
+
+        static selection hyperslab(const std::vector<hsize_t>& start, const std::vector<hsize_t>& stride,
+                                   const std::vector<hsize_t>& count, const std::vector<hsize_t>& block)
+        {
+            return selection{start.size(), false, start, stride, count, block, {}};
+        }
+
+        static selection points(std::size_t ndims, const std::vector<hsize_t>& coords)
+        {
+            return selection{ndims, true, {}, {}, {}, {}, coords};
+        }
+
+        /// The hyperslab `s` of a rank-`N` dataset
+        template <std::size_t N>
+        static selection from(const slabs::slab<N>& s)
+        {
+            return hyperslab({s.start.begin(), s.start.end()}, {s.stride.begin(), s.stride.end()},
+                             {s.count.begin(), s.count.end()}, {s.block.begin(), s.block.end()});
+        }
+
+        /// No elements of a dataset of rank `ndims`
+        static selection none(std::size_t ndims)
+        {
+            const std::vector<hsize_t> zeros(ndims, 0), ones(ndims, 1);
+            return hyperslab(zeros, ones, zeros, ones);
+        }
+
+        /// number of the selected elements
+        hsize_t size() const
+        {
+            if (is_points) return coords.size()/ndims;
+            hsize_t n=1;
+            for (std::size_t d=0; d<ndims; ++d) n*=count[d]*block[d];
+            return n;
+        }
+
+        /// Selects the elements in `space`; hyperslabs may also be added to the selection with `H5S_SELECT_OR`
+        void apply(hid_t space, H5S_seloper_t op=H5S_SELECT_SET) const
+        {
+            if (size()==0) {
+                if (op==H5S_SELECT_SET) h5::check_error(H5Sselect_none(space));
+                return;
+            }
+            if (is_points) {
+                h5::check_error(H5Sselect_elements(space, op, size(), coords.data()));
+            } else {
+                h5::check_error(H5Sselect_hyperslab(space, op, start.data(), stride.data(), count.data(), block.data()));
+            }
+        }
+
+        /// Splits into pieces of at most `max_size` elements, in the buffer order
+        /**
+           A hyperslab is split along its first dimension only, so a piece holds at least
+           one index of it (e.g., one row of a 2D hyperslab), whatever `max_size` is.
+        */
+        std::vector<selection> split(hsize_t max_size) const
+        {
+            std::vector<selection> pieces;
+            const hsize_t n=size();
+            if (n==0) return pieces;
+            max_size=std::max<hsize_t>(max_size, 1);
+            if (is_points) {
+                for (hsize_t i=0; i<n; i+=max_size) {
+                    const hsize_t m=std::min(max_size, n-i);
+                    pieces.push_back(points(ndims, std::vector<hsize_t>(coords.begin()+i*ndims, coords.begin()+(i+m)*ndims)));
+                }
+                return pieces;
+            }
+
+            const hsize_t row=n/(count[0]*block[0]);  // elements per index of the first dimension
+            const hsize_t max_rows=std::max<hsize_t>(1, max_size/row);
+            if (block[0]<=max_rows) {
+                // whole blocks of the first dimension
+                const hsize_t step=max_rows/block[0];
+                for (hsize_t i=0; i<count[0]; i+=step) {
+                    selection piece=*this;
+                    piece.start[0]=start[0]+i*stride[0];
+                    piece.count[0]=std::min(step, count[0]-i);
+                    pieces.push_back(piece);
+                }
+            } else {
+                // parts of a block of the first dimension
+                for (hsize_t i=0; i<count[0]; ++i) {
+                    for (hsize_t j=0; j<block[0]; j+=max_rows) {
+                        selection piece=*this;
+                        piece.start[0]=start[0]+i*stride[0]+j;
+                        piece.count[0]=1;
+                        piece.block[0]=std::min(max_rows, block[0]-j);
+                        pieces.push_back(piece);
+                    }
+                }
+            }
+            return pieces;
+        }
+    };
+
+
+    /// Consecutive elements of the file, placed consecutively in the buffer
+    struct run {
+        hsize_t pos;     ///< position of the first element: its row-major offset in the dataset, plus that of the dataset
+        hsize_t length;
+        hsize_t buf;     ///< offset of the first element in the buffer
+    };
+
+    /// The runs of `sel` in a dataset of extents `dims`, in the buffer order, from the position `pos0` and the buffer offset `buf0`
+    /**
+       The buffer order is the order in which HDF5 transfers the elements: the row-major
+       order for a hyperslab, the listed order for points. Each row of a hyperslab
+       (the extent of its last dimension) is a run of its own.
+    */
+    inline std::vector<run> make_runs(const selection& sel, const std::vector<hsize_t>& dims, hsize_t pos0, hsize_t buf0)
+    {
+        std::vector<run> out;
+        if (sel.size()==0) return out;
+        const std::size_t nd=dims.size();
+        std::vector<hsize_t> lin(nd, 1); // row-major strides of the dimensions
+        for (std::size_t d=nd-1; d>0; --d) lin[d-1]=lin[d]*dims[d];
+
+        hsize_t buf=buf0;
+        if (sel.is_points) {
+            for (std::size_t i=0; i<sel.coords.size(); i+=nd) {
+                hsize_t pos=pos0;
+                for (std::size_t d=0; d<nd; ++d) pos+=sel.coords[i+d]*lin[d];
+                if (!out.empty() && out.back().pos+out.back().length==pos) {
+                    ++out.back().length;
+                } else {
+                    out.push_back({pos, 1, buf});
+                }
+                ++buf;
+            }
+            return out;
+        }
+
+        // the selected indices of the outer dimensions, and the selected segments of a row
+        std::vector< std::vector<hsize_t> > index(nd-1);
+        for (std::size_t d=0; d+1<nd; ++d) {
+            for (hsize_t i=0; i<sel.count[d]; ++i) {
+                for (hsize_t j=0; j<sel.block[d]; ++j) index[d].push_back(sel.start[d]+i*sel.stride[d]+j);
+            }
+        }
+        const std::size_t last=nd-1;
+        std::vector< std::array<hsize_t,2> > segments;
+        if (sel.stride[last]==sel.block[last] || sel.count[last]==1) {
+            segments.push_back({{sel.start[last], sel.count[last]*sel.block[last]}});
+        } else {
+            for (hsize_t i=0; i<sel.count[last]; ++i) {
+                segments.push_back({{sel.start[last]+i*sel.stride[last], sel.block[last]}});
+            }
+        }
+
+        std::vector<std::size_t> idx(nd-1, 0);
+        while (true) {
+            hsize_t row=pos0;
+            for (std::size_t d=0; d+1<nd; ++d) row+=index[d][idx[d]]*lin[d];
+            for (const auto& s: segments) {
+                out.push_back({row+s[0], s[1], buf});
+                buf+=s[1];
+            }
+            std::size_t d=nd-1;
+            while (d>0 && ++idx[d-1]==index[d-1].size()) idx[--d]=0;
+            if (d==0) break;
+        }
+        return out;
+    }
+
+
+    /// Pairs the runs of the same elements in the file (`file_runs`) and in the buffer (`mem_runs`)
+    /**
+       Both are in the buffer order, and `mem_runs` are made from the memory selection and the
+       extents of the buffer, so their positions are offsets in the buffer. The runs of the result
+       are consecutive both in the file and in the buffer.
+    */
+    inline std::vector<run> pair_runs(const std::vector<run>& file_runs, const std::vector<run>& mem_runs)
+    {
+        std::vector<run> out;
+        std::size_t i=0, j=0;
+        hsize_t fi=0, mj=0;  // elements of the current runs already paired
+        while (i<file_runs.size() && j<mem_runs.size()) {
+            const hsize_t n=std::min(file_runs[i].length-fi, mem_runs[j].length-mj);
+            out.push_back({file_runs[i].pos+fi, n, mem_runs[j].pos+mj});
+            fi+=n;
+            mj+=n;
+            if (fi==file_runs[i].length) { ++i; fi=0; }
+            if (mj==mem_runs[j].length) { ++j; mj=0; }
+        }
+        return out;
+    }
+
+
+    /// An access pattern: the extents of the dataset(s), and the elements accessed by each process
+    /**
+       A pattern is made from the parameters of a sweep point, identically on all processes,
+       so any process can find out the selection of any other one.
+    */
+    class pattern {
+      public:
+        virtual ~pattern() {}
+
+        /// extents of each dataset
+        virtual std::vector<hsize_t> dims() const =0;
+
+        /// number of datasets
+        virtual std::size_t ndatasets() const { return 1; }
+
+        /// the elements of the dataset `dset` accessed by the process `rank`
+        virtual selection select(int rank, std::size_t dset) const =0;
+
+        /// adds the parameters of the pattern to a results record
+        virtual void add_params(results::record& rec) const =0;
+
+        /// The buffer of the process `rank` for the dataset `dset`
+        /**
+           Returns false if the buffer holds just the selected elements, one after another
+           (the default). Otherwise sets the extents `mem_dims` of the buffer and the elements
+           `mem_sel` of it that are transferred, as in an application's array with ghost cells.
+        */
+        virtual bool buffer_layout(int /*rank*/, std::size_t /*dset*/, std::vector<hsize_t>& /*mem_dims*/,
+                                   selection& /*mem_sel*/) const
+        {
+            return false;
+        }
+
+        /// Selects in `space` the elements of the dataset `dset` accessed by the process `rank`
+        /**
+           The default applies `select()`; a pattern may select from its precomputed layout
+           instead, without building a `selection`.
+        */
+        virtual void select_in(hid_t space, int rank, std::size_t dset) const
+        {
+            select(rank, dset).apply(space);
+        }
+
+        /// Selects in the buffer space `space` the elements transferred, if `buffer_layout()` returns true
+        virtual void select_buffer_in(hid_t space, int rank, std::size_t dset) const
+        {
+            std::vector<hsize_t> mem_dims;
+            selection mem_sel=selection::none(1);
+            if (buffer_layout(rank, dset, mem_dims, mem_sel)) mem_sel.apply(space);
+        }
+
+        /// the elements of each dataset that no process accesses, added to align the accesses to stripes
+        virtual hsize_t padding() const { return 0; }
+    };
+
+
+    /// Whether the selections of the processes `0..nprocs-1` in the dataset `dset` share elements
+    inline bool overlapping(const pattern& pat, int nprocs, std::size_t dset=0)
+    {
+        const auto dims=pat.dims();
+        std::vector<run> all;
+        for (int rank=0; rank<nprocs; ++rank) {
+            const auto runs=make_runs(pat.select(rank, dset), dims, 0, 0);
+            all.insert(all.end(), runs.begin(), runs.end());
+        }
+        std::sort(all.begin(), all.end(), [](const run& a, const run& b) { return a.pos<b.pos; });
+        for (std::size_t i=1; i<all.size(); ++i) {
+            if (all[i-1].pos+all[i-1].length>all[i].pos) return true;
+        }
+        return false;
+    }
+
+
+    /// Reads `stripe=<bytes>` as a number of elements of `elem_size` bytes to align to (0 if not given, or with `align=no`); false (after printing the reason) if invalid
+    inline bool stripe_elements(const program_options::params_map& par, std::size_t elem_size, hsize_t& elems)
+    {
+        auto maybe_align = par.get_or("align", true);
+        if (!maybe_align) {
+            std::cerr << "align parameter is invalid\n";
+            return false;
+        }
+        auto maybe_stripe = par.get_or<std::size_t>("stripe", 0);
+        if (!maybe_stripe || (*maybe_align && *maybe_stripe%elem_size!=0)) {
+            std::cerr << "stripe parameter is invalid: it must be a multiple of the element size, " << elem_size << " bytes\n";
+            return false;
+        }
+        elems= *maybe_align? *maybe_stripe/elem_size : 0;
+        return true;
+    }
+
+    /// `n` rounded up to a multiple of `m`, or `n` if `m` is 0
+    inline hsize_t round_up(hsize_t n, hsize_t m)
+    {
+        return m==0? n : (n+m-1)/m*m;
+    }
+
+    /// the greatest common divisor of `a` and `b`
+    inline hsize_t gcd(hsize_t a, hsize_t b)
+    {
+        while (b!=0) {
+            const hsize_t r=a%b;
+            a=b;
+            b=r;
+        }
+        return a;
+    }
+
+
+    /// Makes a pattern for `nprocs` processes and elements of `elem_size` bytes; null (after printing the reason) if the parameters are invalid
+    typedef std::unique_ptr<pattern> (*factory)(const program_options::params_map& par, int nprocs, std::size_t elem_size);
+
+    /// An entry of the pattern registry
+    struct entry {
+        std::string name;
+        factory create;
+        std::string usage;  ///< the parameters of the pattern
+        std::string help;   ///< what the processes access
+    };
+
+
+    /// Each process accesses a whole dataset of its own, of `size` MB
+    class per_rank_datasets: public pattern {
+        std::size_t size_mb_;
+        hsize_t size_;
+        int nprocs_;
+
+      public:
+        per_rank_datasets(std::size_t size_mb, hsize_t size, int nprocs): size_mb_(size_mb), size_(size), nprocs_(nprocs) {}
+
+        static std::unique_ptr<pattern> create(const program_options::params_map& par, int nprocs, std::size_t elem_size)
+        {
+            auto maybe_size = par.get<std::size_t>("size");
+            if (!maybe_size || *maybe_size<1) {
+                std::cerr << "size parameter is missing or invalid\n";
+                return nullptr;
+            }
+            return std::unique_ptr<pattern>(new per_rank_datasets(*maybe_size, *maybe_size*1024*1024/elem_size, nprocs));
+        }
+
+        std::vector<hsize_t> dims() const override { return {size_}; }
+
+        std::size_t ndatasets() const override { return nprocs_; }
+
+        selection select(int rank, std::size_t dset) const override
+        {
+            if (dset!=std::size_t(rank)) return selection::none(1);
+            return selection::hyperslab({0}, {1}, {1}, {size_});
+        }
+
+        void add_params(results::record& rec) const override { rec.add("size", size_mb_); }
+    };
+
+
+    /// Slabs of a `rows` x `cols` array: by rows, by columns, tiles of a 2D process grid, or a strided sub-sample
+    /**
+       The rows (columns, tiles) are split between the processes as evenly as possible.
+       The `stride` mode takes every `stride`-th row and column, with the sub-sampled rows
+       split between the processes. With `stripe=<bytes>`, the dataset is padded where the
+       parts of the processes meet, so that each part starts on a stripe boundary: between
+       the blocks of rows (`rows`, `stride`), or between the blocks of columns, in each row
+       (`cols`, `tiles`).
+    */
+    class array_slabs: public pattern {
+        std::string mode_;
+        hsize_t nrows_, ncols_, step_;
+        std::array<int,2> grid_;
+        hsize_t pitch_;                     ///< the extent of the rows in the dataset, with the padding
+        std::vector<hsize_t> row_starts_;   ///< the first row of each block of rows in the dataset, and the number of rows
+        std::vector<hsize_t> col_starts_;   ///< the first column of each block of columns in the dataset
+
+        /// the rows (columns) of the block `i` of `n` blocks of the `extent` rows (columns), sub-sampled
+        hsize_t span(hsize_t extent, hsize_t n, hsize_t i) const
+        {
+            const hsize_t sub=(extent+step_-1)/step_;
+            return std::min(part_start(sub, n, i+1)*step_, extent) - part_start(sub, n, i)*step_;
+        }
+
+        /// The first row of each block of rows, which are padded to a multiple of `multiple` rows, and the number of rows
+        std::vector<hsize_t> pad_rows(hsize_t multiple) const
+        {
+            std::vector<hsize_t> starts(1, 0);
+            for (int i=0; i<grid_[0]; ++i) {
+                const hsize_t n=span(nrows_, grid_[0], i);
+                starts.push_back(starts.back() + (i+1<grid_[0]? round_up(n, multiple) : n));
+            }
+            return starts;
+        }
+
+        /// Lays out the dataset, aligning the parts of the processes to stripes of `stripe` elements (none if 0)
+        void lay_out(hsize_t stripe)
+        {
+            pitch_=ncols_;
+            row_starts_=pad_rows(1);
+            col_starts_.assign(1, 0);
+            for (int j=0; j+1<grid_[1]; ++j) col_starts_.push_back(col_starts_.back()+span(ncols_, grid_[1], j));
+            if (stripe==0) return;
+
+            if (grid_[1]>1) {
+                // each block of columns takes whole stripes, so it starts on a stripe boundary in every row
+                for (int j=0; j<grid_[1]; ++j) {
+                    const hsize_t width=round_up(span(ncols_, grid_[1], j), stripe);
+                    if (j+1<grid_[1]) col_starts_[j+1]=col_starts_[j]+width;
+                    else pitch_=col_starts_[j]+width;
+                }
+                return;
+            }
+
+            /*
+             * A block of rows starts on a stripe boundary if its first row times the pitch is a
+             * multiple of the stripe: the rows are padded to a divisor of the stripe, and the blocks
+             * to the multiple of rows this needs. The divisor giving the smallest dataset is taken.
+             */
+            hsize_t best_size=0;
+            for (hsize_t f=1; f*f<=stripe; ++f) {
+                if (stripe%f!=0) continue;
+                for (hsize_t d: {f, stripe/f}) {
+                    const hsize_t pitch=round_up(ncols_, d);
+                    const auto starts=pad_rows(stripe/gcd(stripe, pitch));
+                    const hsize_t size=starts.back()*pitch;
+                    if (best_size==0 || size<best_size || (size==best_size && pitch<pitch_)) {
+                        best_size=size;
+                        pitch_=pitch;
+                        row_starts_=starts;
+                    }
+                }
+            }
+        }
+
+        /// the process grid of the mode: a column of processes, a row of them, or a 2D grid
+        static std::array<int,2> process_grid(const std::string& mode, int nprocs)
+        {
+            std::array<int,2> grid={{nprocs, 1}};
+            if (mode=="cols") {
+                grid={{1, nprocs}};
+            } else if (mode=="tiles") {
+                grid={{0, 0}};
+                MPI_Dims_create(nprocs, 2, grid.data());
+            }
+            return grid;
+        }
+
+      public:
+        array_slabs(const std::string& mode, hsize_t nrows, hsize_t ncols, hsize_t step, hsize_t stripe, int nprocs)
+            : mode_(mode), nrows_(nrows), ncols_(ncols), step_(step), grid_(process_grid(mode, nprocs))
+        {
+            lay_out(stripe);
+        }
+
+        static std::unique_ptr<pattern> create(const std::string& mode, const program_options::params_map& par, int nprocs,
+                                               std::size_t elem_size)
+        {
+            auto maybe_rows = par.get<std::size_t>("rows");
+            if (!maybe_rows || *maybe_rows<1) {
+                std::cerr << "rows parameter is missing or invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_cols = par.get<std::size_t>("cols");
+            if (!maybe_cols || *maybe_cols<1) {
+                std::cerr << "cols parameter is missing or invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_stride = par.get_or<std::size_t>("stride", 2);
+            if (!maybe_stride || *maybe_stride<1) {
+                std::cerr << "stride parameter is invalid\n";
+                return nullptr;
+            }
+            const hsize_t step= mode=="stride"? *maybe_stride : 1;
+
+            hsize_t stripe;
+            if (!stripe_elements(par, elem_size, stripe)) return nullptr;
+            const int ncol_blocks=process_grid(mode, nprocs)[1];
+            if (stripe>0 && ncol_blocks>1 && *maybe_cols/ncol_blocks<stripe) {
+                // each block would be padded to a stripe in every row: mostly padding
+                std::cerr << "stripe parameter is invalid: the " << ncol_blocks << " blocks of columns of " << mode
+                          << " are narrower than a stripe (use align=no)\n";
+                return nullptr;
+            }
+            return std::unique_ptr<pattern>(new array_slabs(mode, *maybe_rows, *maybe_cols, step, stripe, nprocs));
+        }
+
+        static std::unique_ptr<pattern> create_rows(const program_options::params_map& par, int nprocs, std::size_t elem_size)
+        {
+            return create("rows", par, nprocs, elem_size);
+        }
+
+        static std::unique_ptr<pattern> create_cols(const program_options::params_map& par, int nprocs, std::size_t elem_size)
+        {
+            return create("cols", par, nprocs, elem_size);
+        }
+
+        static std::unique_ptr<pattern> create_tiles(const program_options::params_map& par, int nprocs, std::size_t elem_size)
+        {
+            return create("tiles", par, nprocs, elem_size);
+        }
+
+        static std::unique_ptr<pattern> create_stride(const program_options::params_map& par, int nprocs, std::size_t elem_size)
+        {
+            return create("stride", par, nprocs, elem_size);
+        }
+
+        std::vector<hsize_t> dims() const override { return {row_starts_.back(), pitch_}; }
+
+        hsize_t padding() const override { return row_starts_.back()*pitch_ - nrows_*ncols_; }
+
+        selection select(int rank, std::size_t) const override
+        {
+            // extents of the (sub-sampled) array
+            const hsize_t srows=(nrows_+step_-1)/step_, scols=(ncols_+step_-1)/step_;
+            const hsize_t gi=rank/grid_[1], gj=rank%grid_[1];
+            const hsize_t r0=part_start(srows, grid_[0], gi), r1=part_start(srows, grid_[0], gi+1);
+            const hsize_t c0=part_start(scols, grid_[1], gj), c1=part_start(scols, grid_[1], gj+1);
+            return selection::hyperslab({row_starts_[gi], col_starts_[gj]}, {step_, step_}, {r1-r0, c1-c0}, {1, 1});
+        }
+
+        void add_params(results::record& rec) const override
+        {
+            rec.add("rows", nrows_).add("cols", ncols_);
+            if (mode_=="stride") rec.add("stride", step_);
+        }
+    };
+
+
+    /// Blocks of `blocksize` elements of all processes in turn, separated by gaps of `gap` elements, `repeat` times
+    /**
+       With 3 processes and `repeat=2` the dataset looks like `B11 G B21 G B31 G B12 G B22 G B32`,
+       where `Bnm` is the block of the process `n` on the repetition `m`, and `G` is a gap.
+       A negative gap makes the blocks of neighbouring processes overlap. With `stripe=<bytes>`,
+       the gaps are widened so that each block starts on a stripe boundary.
+    */
+    class strided_blocks: public pattern {
+        hsize_t bsize_;
+        std::ptrdiff_t gap_;
+        hsize_t repeat_;
+        int nprocs_;
+        hsize_t pad_;  ///< the elements added to each gap
+
+        /// the extent of the dataset with gaps of `gap` elements
+        hsize_t extent(std::ptrdiff_t gap) const
+        {
+            return (bsize_+gap)*repeat_*nprocs_ - (gap>0? gap : 0);
+        }
+
+      public:
+        strided_blocks(hsize_t bsize, std::ptrdiff_t gap, hsize_t repeat, int nprocs, hsize_t pad)
+            : bsize_(bsize), gap_(gap), repeat_(repeat), nprocs_(nprocs), pad_(pad) {}
+
+        static std::unique_ptr<pattern> create(const program_options::params_map& par, int nprocs, std::size_t elem_size)
+        {
+            auto maybe_bsize = par.get<std::size_t>("blocksize");
+            if (!maybe_bsize) {
+                std::cerr << "blocksize parameter is missing or invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_gap = par.get_or<std::ptrdiff_t>("gap", 0);
+            if (!maybe_gap) {
+                std::cerr << "gap parameter is missing or invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_repeat = par.get_or<std::size_t>("repeat", 1);
+            if (!maybe_repeat) {
+                std::cerr << "repeat parameter is missing or invalid\n";
+                return nullptr;
+            }
+
+            const std::ptrdiff_t bsize=*maybe_bsize;
+            const std::ptrdiff_t stride=(bsize + *maybe_gap)*nprocs;
+            if (bsize<=0 || *maybe_repeat<1 || bsize + *maybe_gap<=0 || (*maybe_repeat>1 && stride<bsize)) {
+                std::cerr << "Incorrect values of parameters\n";
+                return nullptr;
+            }
+
+            hsize_t stripe;
+            if (!stripe_elements(par, elem_size, stripe)) return nullptr;
+            const hsize_t pitch=bsize + *maybe_gap;
+            return std::unique_ptr<pattern>(new strided_blocks(*maybe_bsize, *maybe_gap, *maybe_repeat, nprocs,
+                                                               round_up(pitch, stripe)-pitch));
+        }
+
+        std::vector<hsize_t> dims() const override { return {extent(gap_+pad_)}; }
+
+        hsize_t padding() const override { return extent(gap_+pad_)-extent(gap_); }
+
+        selection select(int rank, std::size_t) const override
+        {
+            const hsize_t pitch=bsize_+gap_+pad_;
+            return selection::hyperslab({rank*pitch}, {pitch*nprocs_}, {repeat_}, {bsize_});
+        }
+
+        void add_params(results::record& rec) const override
+        {
+            rec.add("blocksize", bsize_).add("gap", gap_).add("repeat", repeat_);
+        }
+    };
+
+
+    /// The indices of the elements of a 1D dataset owned by the process `rank`, in the buffer order
+    /**
+       The dataset is viewed as a sequence of clusters of `cluster_size` elements;
+       cluster `k*nprocs+rank` may only be owned by process `rank`, so the index sets
+       of different processes never overlap. Each process picks its clusters
+       randomly out of `spread` times as many as it needs.
+    */
+    inline std::vector<hsize_t> point_indices(hsize_t count, hsize_t cluster_size, bool is_sorted,
+                                              hsize_t spread, unsigned long seed, int rank, int nprocs)
+    {
+        const hsize_t csize=cluster_size;
+        const hsize_t nclusters=(count+csize-1)/csize;
+
+        std::vector<hsize_t> slots(nclusters*spread);
+        std::iota(slots.begin(), slots.end(), 0);
+
+        // partial Fisher-Yates shuffle: the first `nclusters` slots are a random sample
+        std::mt19937_64 rng(seed+rank);
+        for (hsize_t i=0; i<nclusters; ++i) {
+            std::uniform_int_distribution<hsize_t> pick(i, slots.size()-1);
+            std::swap(slots[i], slots[pick(rng)]);
+        }
+        slots.resize(nclusters);
+        if (is_sorted) std::sort(slots.begin(), slots.end());
+
+        std::vector<hsize_t> indices;
+        indices.reserve(count);
+        for (auto k: slots) {
+            const hsize_t first=(k*nprocs+rank)*csize;
+            for (hsize_t j=0; j<csize && indices.size()<count; ++j) {
+                indices.push_back(first+j);
+            }
+        }
+        return indices;
+    }
+
+
+    /// Irregular sets of `count` elements per process of a 1D dataset, as a point selection
+    class scattered_points: public pattern {
+        hsize_t count_;
+        std::string locality_;
+        hsize_t cluster_size_;
+        bool is_sorted_;
+        hsize_t spread_;
+        unsigned long seed_;
+        int nprocs_;
+
+      public:
+        scattered_points(hsize_t count, const std::string& locality, hsize_t cluster_size, bool is_sorted,
+                         hsize_t spread, unsigned long seed, int nprocs)
+            : count_(count), locality_(locality), cluster_size_(cluster_size), is_sorted_(is_sorted),
+              spread_(spread), seed_(seed), nprocs_(nprocs) {}
+
+        static std::unique_ptr<pattern> create(const program_options::params_map& par, int nprocs, std::size_t)
+        {
+            auto maybe_count = par.get<std::size_t>("count");
+            if (!maybe_count || *maybe_count<1) {
+                std::cerr << "count parameter is missing or invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_locality = par.get_or("locality", "random");
+            if (!maybe_locality || (*maybe_locality!="random" && *maybe_locality!="clustered")) {
+                std::cerr << "locality parameter is invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_cluster = par.get_or<std::size_t>("cluster", 64);
+            if (!maybe_cluster || *maybe_cluster<1) {
+                std::cerr << "cluster parameter is invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_sorted = par.get_or("sorted", true);
+            if (!maybe_sorted) {
+                std::cerr << "sorted parameter is invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_spread = par.get_or<std::size_t>("spread", 4);
+            if (!maybe_spread || *maybe_spread<1) {
+                std::cerr << "spread parameter is invalid\n";
+                return nullptr;
+            }
+
+            auto maybe_seed = par.get_or<unsigned long>("seed", 12345);
+            if (!maybe_seed) {
+                std::cerr << "seed parameter is invalid\n";
+                return nullptr;
+            }
+
+            return std::unique_ptr<pattern>(new scattered_points(
+                *maybe_count, *maybe_locality, *maybe_locality=="clustered"? *maybe_cluster : 1,
+                *maybe_sorted, *maybe_spread, *maybe_seed, nprocs));
+        }
+
+        std::vector<hsize_t> dims() const override
+        {
+            return {(count_+cluster_size_-1)/cluster_size_*spread_*nprocs_*cluster_size_};
+        }
+
+        selection select(int rank, std::size_t) const override
+        {
+            return selection::points(1, point_indices(count_, cluster_size_, is_sorted_, spread_, seed_, rank, nprocs_));
+        }
+
+        void add_params(results::record& rec) const override
+        {
+            rec .add("count", count_)
+               .add("locality", locality_)
+               .add("cluster", cluster_size_)
+               .add("sorted", is_sorted_)
+               .add("spread", spread_)
+               .add("seed", seed_);
+        }
+    };
+
+
+    /// Blocks of an N-dimensional array, decomposed over an N-dimensional grid of processes
+    /**
+       Reproduces domain-decomposed fields (e.g., `dims=512x512x512 grid=4x4x4`) and, with
+       a grid extent of 1 along the first dimension, time-varying volumes of which each
+       process writes all the time steps of its sub-volume. With `cyclic=`, the blocks are
+       dealt out round-robin, so each process writes a strided hyperslab. With `ghost=`, the
+       part of each process is the interior of a local array with ghost cells on all sides.
+       The file and buffer selections are set from the fixed-size slabs of the decomposition.
+    */
+    template <std::size_t N>
+    class grid_blocks: public pattern {
+        slabs::decomposition<N> decomp_;
+
+      public:
+        explicit grid_blocks(const slabs::decomposition<N>& decomp): decomp_(decomp) {}
+
+        std::vector<hsize_t> dims() const override { return {decomp_.dims().begin(), decomp_.dims().end()}; }
+
+        selection select(int rank, std::size_t) const override
+        {
+            return selection::from(decomp_.file_slab(rank));
+        }
+
+        void select_in(hid_t space, int rank, std::size_t) const override
+        {
+            decomp_.file_slab(rank).apply(space);
+        }
+
+        void select_buffer_in(hid_t space, int rank, std::size_t) const override
+        {
+            decomp_.memory_slab(rank).apply(space);
+        }
+
+        bool buffer_layout(int rank, std::size_t, std::vector<hsize_t>& mem_dims, selection& mem_sel) const override
+        {
+            const auto& ghost=decomp_.ghost();
+            if (std::all_of(ghost.begin(), ghost.end(), [](hsize_t g) { return g==0; })) return false;
+            const auto local=decomp_.local_dims(rank);
+            mem_dims.assign(local.begin(), local.end());
+            mem_sel=selection::from(decomp_.memory_slab(rank));
+            return true;
+        }
+
+        void add_params(results::record& rec) const override
+        {
+            auto join=[](const typename slabs::decomposition<N>::extents& e) {
+                std::string s;
+                for (auto x: e) s+=(s.empty()? "" : "x")+std::to_string(x);
+                return s;
+            };
+            rec .add("dims", join(decomp_.dims()))
+               .add("grid", join(decomp_.grid()))
+               .add("ghost", join(decomp_.ghost()))
+               .add("cyclic", join(decomp_.cyclic()));
+        }
+    };
+
+    /// Makes a `grid_blocks` pattern of the rank given at run time
+    struct grid_blocks_maker {
+        const std::vector<hsize_t>& dims;
+        const std::vector<hsize_t>& grid;
+        const std::vector<hsize_t>& ghost;
+        const std::vector<hsize_t>& cyclic;
+        std::unique_ptr<pattern> made;
+
+        template <std::size_t N>
+        void run()
+        {
+            typename slabs::decomposition<N>::extents d, p, g, c;
+            std::copy(dims.begin(), dims.end(), d.begin());
+            std::copy(grid.begin(), grid.end(), p.begin());
+            std::copy(ghost.begin(), ghost.end(), g.begin());
+            std::copy(cyclic.begin(), cyclic.end(), c.begin());
+            made.reset(new grid_blocks<N>(slabs::decomposition<N>(d, p, g, c)));
+        }
+    };
+
+    /// Makes a `grid_blocks` pattern from `dims=AxBx...`, `grid=PxQx...` (by default, as `MPI_Dims_create()` chooses), `ghost=GxGx...` and `cyclic=BxBx...`
+    inline std::unique_ptr<pattern> create_grid_blocks(const program_options::params_map& par, int nprocs, std::size_t)
+    {
+        auto maybe_dims = par.get<std::string>("dims");
+        const auto dims= maybe_dims? parse_extents(*maybe_dims) : std::vector<hsize_t>();
+        if (dims.empty() || dims.size()>slabs::max_rank) {
+            std::cerr << "dims parameter is missing or invalid (at most " << slabs::max_rank << " extents)\n";
+            return nullptr;
+        }
+
+        auto maybe_grid = par.get_or("grid", "auto");
+        std::vector<hsize_t> grid;
+        if (maybe_grid && *maybe_grid=="auto") {
+            std::vector<int> g(dims.size(), 0);
+            MPI_Dims_create(nprocs, g.size(), g.data());
+            grid.assign(g.begin(), g.end());
+        } else if (maybe_grid) {
+            grid=parse_extents(*maybe_grid);
+        }
+        hsize_t grid_size=1;
+        for (auto g: grid) grid_size*=g;
+        if (grid.size()!=dims.size() || grid_size!=hsize_t(nprocs)) {
+            std::cerr << "grid parameter is invalid: it must have " << dims.size()
+                      << " extents, whose product is the number of processes\n";
+            return nullptr;
+        }
+
+        auto maybe_ghost = par.get_or("ghost", "0");
+        auto ghost= maybe_ghost? parse_extents(*maybe_ghost, 0) : std::vector<hsize_t>();
+        if (ghost.size()==1) ghost.resize(dims.size(), ghost[0]);
+        if (ghost.size()!=dims.size()) {
+            std::cerr << "ghost parameter is invalid\n";
+            return nullptr;
+        }
+
+        auto maybe_cyclic = par.get_or("cyclic", "0");
+        auto cyclic= maybe_cyclic? parse_extents(*maybe_cyclic, 0) : std::vector<hsize_t>();
+        if (cyclic.size()==1) cyclic.resize(dims.size(), cyclic[0]);
+        bool cyclic_ok= cyclic.size()==dims.size();
+        for (std::size_t d=0; cyclic_ok && d<dims.size(); ++d) {
+            cyclic_ok= cyclic[d]==0 || dims[d]%(grid[d]*cyclic[d])==0;
+        }
+        if (!cyclic_ok) {
+            std::cerr << "cyclic parameter is invalid: each extent must be a multiple of the grid extent times the block\n";
+            return nullptr;
+        }
+
+        grid_blocks_maker maker={dims, grid, ghost, cyclic, nullptr};
+        slabs::dispatch_rank(dims.size(), maker);
+        return std::move(maker.made);
+    }
+
+
+    /// The registered patterns; initially the built-in ones
+    inline std::vector<entry>& registry()
+    {
+        static std::vector<entry> reg={
+            {"datasets", &per_rank_datasets::create, "size=<MB_per_process>",
+             "each process writes a dataset of its own"},
+            {"rows", &array_slabs::create_rows, "rows=<number> cols=<number>",
+             "each process writes a slab of rows of a 2D array"},
+            {"cols", &array_slabs::create_cols, "rows=<number> cols=<number>",
+             "each process writes a slab of columns of a 2D array"},
+            {"tiles", &array_slabs::create_tiles, "rows=<number> cols=<number>",
+             "each process writes a tile of a 2D process grid"},
+            {"stride", &array_slabs::create_stride, "rows=<number> cols=<number> [stride=<number>]",
+             "each process writes a share of every stride-th row and column"},
+            {"blocks", &strided_blocks::create,
+             "blocksize=<values_per_block> [gap=<gap_size_in_values>] [repeat=<block_repeat_factor>]",
+             "each process writes repeated blocks, interleaved with those of the others"},
+            {"points", &scattered_points::create,
+             "count=<elements_per_process> [locality=<random|clustered>] [cluster=<elements_per_cluster>]"
+             " [sorted=<yes|no>] [spread=<dataset_size_factor>] [seed=<number>]",
+             "each process writes an irregular set of elements, as a point selection"},
+            {"grid", &create_grid_blocks, "dims=<AxBx...> [grid=<PxQx...|auto>] [ghost=<cells|GxGx...>] [cyclic=<cells|BxBx...>]",
+             "each process writes a block of an N-dimensional array, decomposed over a process grid"}
+        };
+        return reg;
+    }
+
+    /// Adds a pattern to the registry, replacing a pattern of the same name
+    inline void register_pattern(const entry& e)
+    {
+        for (auto& known: registry()) {
+            if (known.name==e.name) {
+                known=e;
+                return;
+            }
+        }
+        registry().push_back(e);
+    }
+
+    /// The registered pattern `name`, or null
+    inline const entry* find(const std::string& name)
+    {
+        for (const auto& known: registry()) {
+            if (known.name==name) return &known;
+        }
+        return nullptr;
+    }
+
+    /// Makes the registered pattern `name`; null (after printing the reason) if the name or the parameters are invalid
+    inline std::unique_ptr<pattern> create(const std::string& name, const program_options::params_map& par,
+                                           int nprocs, std::size_t elem_size)
+    {
+        const entry* e=find(name);
+        if (!e) {
+            std::cerr << "Unknown pattern " << name << "\n";
+            return nullptr;
+        }
+        return e->create(par, nprocs, elem_size);
+    }
+}
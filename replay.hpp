@@ -0,0 +1,171 @@
+/** @file replay.hpp
+    The I/O traces replayed by `h5replay`: a sequence of file and dataset creates and of per-process reads and writes
+
+    A trace is a text file with one operation per line; `#` starts a comment:
+
+        ranks 4                                  # the number of processes that made the trace (first)
+        file create out.h5                       # creates (or truncates) the file
+        dataset create temp double 8x64x64 4x64x64   # name, element type, extents, chunk extents or `contiguous`
+        step 0.25                                # starts a step, after 0.25 s of computation
+        write temp 0 0x0x0 1x1x1 1x1x1 2x64x64   # dataset, process, hyperslab start, stride, count, block
+        write temp 1 2x0x0 1x1x1 1x1x1 2x64x64
+        file close
+        file open out.h5                         # opens an existing file, to read it
+        step 0
+        read temp 0 0x0x0 1x1x1 1x1x1 4x64x64
+        file close
+
+    Within a step, every process transfers its selections of each dataset in one call,
+    in the order in which the step first names the datasets.
+*/
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#include <hdf5.h>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_types.hpp"
+#include "patterns.hpp"
+
+namespace replay {
+
+    /// One operation of a trace
+    struct op {
+        enum kind_type { create_file, open_file, close_file, create_dataset, step, write, read };
+
+        kind_type kind;
+        std::string name;              ///< the file or the dataset
+        std::string type_name;         ///< the element type of a created dataset
+        std::vector<hsize_t> dims;     ///< the extents of a created dataset
+        std::vector<hsize_t> chunk;    ///< the chunk extents of a created dataset; empty if contiguous
+        double gap;                    ///< the computation time before a step, in seconds
+        int rank;                      ///< the process that reads or writes
+        patterns::selection sel;       ///< the hyperslab it reads or writes
+    };
+
+    /// A trace: the number of processes that made it, and the operations
+    struct trace {
+        int nranks;
+        std::vector<op> ops;
+    };
+
+
+    /// Parses a trace; empty (after printing the reason) if it is invalid
+    inline program_options::optional<trace> parse(std::istream& in)
+    {
+        const program_options::optional<trace> empty;
+        trace tr={0, {}};
+        std::string line;
+        std::size_t lineno=0;
+        bool file_open=false;
+        auto fail=[&](const std::string& why) {
+            std::cerr << "Trace line " << lineno << ": " << why << "\n";
+            return empty;
+        };
+        while (std::getline(in, line)) {
+            ++lineno;
+            const auto hash=line.find('#');
+            if (hash!=std::string::npos) line.erase(hash);
+            std::istringstream words(line);
+            std::string what;
+            if (!(words >> what)) continue;
+            if (tr.nranks==0 && what!="ranks") return fail("the trace must start with `ranks <number>`");
+
+            op o={op::step, "", "", {}, {}, 0., 0, patterns::selection::none(1)};
+            std::string word, extra;
+            if (what=="ranks") {
+                if (tr.nranks!=0 || !(words >> tr.nranks) || tr.nranks<1) return fail("invalid number of ranks");
+                continue;
+            } else if (what=="file") {
+                if (!(words >> word)) return fail("`file create|open|close` expected");
+                if (word=="close") {
+                    if (!file_open) return fail("no file is open");
+                    o.kind=op::close_file;
+                    file_open=false;
+                } else if (word=="create" || word=="open") {
+                    if (file_open) return fail("a file is already open");
+                    if (!(words >> o.name)) return fail("file name expected");
+                    o.kind= word=="create"? op::create_file : op::open_file;
+                    file_open=true;
+                } else {
+                    return fail("`file create|open|close` expected");
+                }
+            } else if (what=="dataset") {
+                std::string dims, chunk;
+                if (!(words >> word >> o.name >> o.type_name >> dims >> chunk) || word!="create") {
+                    return fail("`dataset create <name> <type> <extents> <chunk|contiguous>` expected");
+                }
+                if (!file_open) return fail("no file is open");
+                if (!h5::is_known_type(o.type_name)) return fail("unknown type "+o.type_name);
+                o.kind=op::create_dataset;
+                o.dims=patterns::parse_extents(dims);
+                if (o.dims.empty()) return fail("invalid extents "+dims);
+                if (chunk!="contiguous") {
+                    o.chunk=patterns::parse_extents(chunk);
+                    if (o.chunk.size()!=o.dims.size()) return fail("invalid chunk extents "+chunk);
+                }
+            } else if (what=="step") {
+                if (!(words >> o.gap) || o.gap<0) return fail("`step <seconds>` expected");
+                o.kind=op::step;
+            } else if (what=="write" || what=="read") {
+                std::string ext[4];
+                if (!(words >> o.name >> o.rank >> ext[0] >> ext[1] >> ext[2] >> ext[3])) {
+                    return fail("`"+what+" <dataset> <rank> <start> <stride> <count> <block>` expected");
+                }
+                if (!file_open) return fail("no file is open");
+                if (o.rank<0 || o.rank>=tr.nranks) return fail("invalid rank");
+                std::vector<hsize_t> e[4];
+                for (int i=0; i<4; ++i) e[i]=patterns::parse_extents(ext[i], i==0 || i==2? 0 : 1);
+                for (int i=0; i<4; ++i) {
+                    if (e[i].empty() || e[i].size()!=e[0].size()) return fail("invalid hyperslab");
+                }
+                o.kind= what=="write"? op::write : op::read;
+                o.sel=patterns::selection::hyperslab(e[0], e[1], e[2], e[3]);
+            } else {
+                return fail("unknown operation "+what);
+            }
+            if (words >> extra) return fail("unexpected "+extra);
+            tr.ops.push_back(o);
+        }
+        if (tr.nranks==0) return fail("the trace is empty");
+        if (file_open) return fail("the file is not closed");
+        return program_options::make_optional(tr);
+    }
+
+
+    /// Formats extents as `AxBx...`
+    inline std::string extents(const std::vector<hsize_t>& e)
+    {
+        std::string s;
+        for (auto x: e) s+=(s.empty()? "" : "x")+std::to_string(x);
+        return s;
+    }
+
+    /// Writes the `write` or `read` line of the selection `sel` of a process; false if `sel` is not a hyperslab
+    inline bool write_selection(std::ostream& out, const std::string& what, const std::string& dset, int rank,
+                                const patterns::selection& sel)
+    {
+        if (sel.is_points) return false;
+        if (sel.size()==0) return true;
+        out << what << " " << dset << " " << rank << " " << extents(sel.start) << " " << extents(sel.stride)
+            << " " << extents(sel.count) << " " << extents(sel.block) << "\n";
+        return true;
+    }
+
+    /// Writes the operations of one step by `nprocs` processes in the pattern `pat`, for the datasets `dset_names`
+    inline bool write_step(std::ostream& out, const std::string& what, const patterns::pattern& pat, int nprocs,
+                           const std::vector<std::string>& dset_names, double gap=0.)
+    {
+        out << "step " << gap << "\n";
+        for (std::size_t d=0; d<dset_names.size(); ++d) {
+            for (int r=0; r<nprocs; ++r) {
+                if (!write_selection(out, what, dset_names[d], r, pat.select(r, d))) return false;
+            }
+        }
+        return true;
+    }
+}
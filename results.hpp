@@ -0,0 +1,265 @@
+/** @file results.hpp
+    Machine-readable benchmark results: one record per measurement, as CSV or JSON lines
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <ctime>
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+
+#include <mpiwrap/mpiwrap.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "sweep.hpp"
+
+namespace results {
+
+    /// Joins the strings with the separator `sep`
+    inline std::string join(const std::vector<std::string>& strs, const std::string& sep)
+    {
+        std::string out;
+        for (const auto& s: strs) {
+            if (!out.empty()) out+=sep;
+            out+=s;
+        }
+        return out;
+    }
+
+
+    /// The current time in UTC, in the ISO 8601 format
+    inline std::string utc_time()
+    {
+        const std::time_t now=std::time(nullptr);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        return buf;
+    }
+
+
+    /// A measurement: named values, in the order they were added
+    class record {
+        struct field {
+            std::string key;
+            std::string value;
+            bool is_string;
+        };
+        std::vector<field> fields_;
+
+        static std::string csv_quote(const std::string& s)
+        {
+            if (s.find_first_of(",\"\n")==std::string::npos) return s;
+            std::string out="\"";
+            for (char c: s) {
+                if (c=='"') out+='"';
+                out+=c;
+            }
+            return out+"\"";
+        }
+
+        static std::string json_quote(const std::string& s)
+        {
+            std::string out="\"";
+            for (char c: s) {
+                if (c=='"' || c=='\\') out+='\\';
+                if (static_cast<unsigned char>(c)<0x20) {
+                    char esc[8];
+                    std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    out+=esc;
+                    continue;
+                }
+                out+=c;
+            }
+            return out+"\"";
+        }
+
+      public:
+        record& add(const std::string& key, const std::string& value)
+        {
+            fields_.push_back({key, value, true});
+            return *this;
+        }
+
+        record& add(const std::string& key, const char* value)
+        {
+            return add(key, std::string(value));
+        }
+
+        record& add(const std::string& key, bool value)
+        {
+            fields_.push_back({key, value? "true" : "false", false});
+            return *this;
+        }
+
+        /// Non-finite values (e.g., a bandwidth of an empty transfer) are recorded as null
+        record& add(const std::string& key, double value)
+        {
+            std::ostringstream strm;
+            strm << std::setprecision(9) << value;
+            fields_.push_back({key, std::isfinite(value)? strm.str() : "null", false});
+            return *this;
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, record&>::type
+        add(const std::string& key, T value)
+        {
+            fields_.push_back({key, std::to_string(value), false});
+            return *this;
+        }
+
+        std::string csv_header() const
+        {
+            std::vector<std::string> keys;
+            for (const auto& f: fields_) keys.push_back(csv_quote(f.key));
+            return join(keys, ",");
+        }
+
+        std::string csv_row() const
+        {
+            std::vector<std::string> values;
+            for (const auto& f: fields_) values.push_back(f.value=="null"? "" : csv_quote(f.value));
+            return join(values, ",");
+        }
+
+        std::string json() const
+        {
+            std::vector<std::string> pairs;
+            for (const auto& f: fields_) {
+                pairs.push_back(json_quote(f.key)+": "+(f.is_string? json_quote(f.value) : f.value));
+            }
+            return "{"+join(pairs, ", ")+"}";
+        }
+
+        /// The fields as `key=value` pairs, for humans
+        std::string text() const
+        {
+            std::vector<std::string> pairs;
+            for (const auto& f: fields_) pairs.push_back(f.key+"="+f.value);
+            return join(pairs, " ");
+        }
+    };
+
+
+    /// Where the benchmark runs, and with which libraries
+    struct run_info {
+        int nprocs;
+        std::vector<std::string> hosts;  ///< distinct node names, in the order of their first rank
+        std::vector<int> procs_on_host;  ///< number of processes on each of `hosts`
+        std::string hdf5_version;
+        std::string mpi_version;
+
+        /// Collective; the node names are available on `root` only
+        static run_info collect(const mpiwrap::communicator& comm, int root)
+        {
+            run_info info={comm.size(), {}, {}, h5::library_version(), mpiwrap::library_version()};
+            for (const auto& name: mpiwrap::gather(comm, mpiwrap::processor_name(), root)) {
+                std::size_t i=0;
+                while (i<info.hosts.size() && info.hosts[i]!=name) ++i;
+                if (i==info.hosts.size()) {
+                    info.hosts.push_back(name);
+                    info.procs_on_host.push_back(0);
+                }
+                ++info.procs_on_host[i];
+            }
+            return info;
+        }
+
+        /// One line for humans, with at most `max_hosts` node names
+        std::string summary(std::size_t max_hosts=4) const
+        {
+            std::ostringstream strm;
+            strm << nprocs << " processes on " << hosts.size() << " nodes (";
+            for (std::size_t i=0; i<hosts.size() && i<max_hosts; ++i) {
+                strm << (i>0? ", " : "") << hosts[i] << " x" << procs_on_host[i];
+            }
+            if (hosts.size()>max_hosts) strm << ", ... " << hosts.size()-max_hosts << " more";
+            strm << "), HDF5 " << hdf5_version << ", " << mpi_version;
+            return strm.str();
+        }
+
+        void add_to(record& rec) const
+        {
+            rec.add("nprocs", nprocs)
+               .add("nnodes", hosts.size())
+               .add("hdf5_version", hdf5_version)
+               .add("mpi_version", mpi_version)
+               .add("hosts", join(hosts, " "));
+        }
+    };
+
+
+    /// Adds the timings of a sweep point; `read_name` names the read phase of the benchmark
+    inline void add_result(record& rec, const sweep::point_result& res, const std::string& read_name)
+    {
+        rec.add("prepare_s", res.prepare_time)
+           .add("write_MB", res.write_mbytes)
+           .add("write_s", res.write_time)
+           .add("write_MBps", res.write_mbytes/res.write_time)
+           .add("write_io_mode", res.write_mode)
+           .add(read_name+"_MB", res.read_mbytes)
+           .add(read_name+"_s", res.read_time)
+           .add(read_name+"_MBps", res.read_time>0? res.read_mbytes/res.read_time : 0.)
+           .add(read_name+"_io_mode", res.read_mode);
+    }
+
+
+    /// Writes records as CSV (with one header line) or as JSON lines
+    /**
+       A CSV file has a single header line, so that it loads into any CSV reader: all records
+       must have its columns, those of the first record written or, when appending to a
+       non-empty file, those of its header line. Other records are refused; JSON lines take
+       records with any fields.
+    */
+    class writer {
+        bool is_csv_;
+        std::ofstream file_;
+        std::ostream* os_;
+        std::string header_;   ///< the header line of the file; empty if none yet
+
+      public:
+        /// The `path` "-" means the standard output; an empty `path` disables the output
+        writer(const std::string& path, const std::string& format)
+            : is_csv_(format=="csv"), file_(), os_(nullptr), header_()
+        {
+            if (path.empty()) return;
+            if (path=="-") {
+                os_=&std::cout;
+                return;
+            }
+            if (is_csv_) {
+                std::ifstream existing(path);
+                std::getline(existing, header_);
+            }
+            file_.open(path, std::ios::app);
+            if (!file_) throw std::runtime_error("Cannot open results file "+path);
+            os_=&file_;
+        }
+
+        explicit operator bool() const { return os_!=nullptr; }
+
+        /// Writes the record; false if it is refused, as its columns differ from those of the CSV file
+        bool write(const record& rec)
+        {
+            if (!os_) return true;
+            if (is_csv_) {
+                const std::string header=rec.csv_header();
+                if (header_.empty()) {
+                    *os_ << header << "\n";
+                    header_=header;
+                } else if (header!=header_) {
+                    return false;
+                }
+            }
+            *os_ << (is_csv_? rec.csv_row() : rec.json()) << std::endl;
+            return true;
+        }
+    };
+}
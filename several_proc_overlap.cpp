@@ -0,0 +1,337 @@
+/** @file several_proc_overlap.cpp Overlaps a synthetic computation with writing the previous step
+
+    Each time step, the main thread computes into one of two buffers while a background
+    thread writes the other buffer (the result of the previous step) into the file.
+    The computation and the output are also timed alone, to find how much of the I/O
+    time is hidden and how much the computation slows down when I/O runs alongside.
+ */
+
+#include <vector>
+#include <array>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <mpiwrap/mpiwrap.hpp>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "parse_and_bcast.hpp"
+
+namespace po=program_options;
+namespace mpi=mpiwrap;
+
+struct my_params {
+    std::string file_name;
+    std::size_t size;
+    std::size_t nsteps;
+    std::size_t work;
+    std::string data_name;
+    bool do_collective;
+
+    /// Visits the fields, to broadcast the parameters in one message
+    template <typename A>
+    void serialize(A& ar)
+    {
+        ar & file_name
+           & size
+           & nsteps
+           & work
+           & data_name
+           & do_collective;
+    }
+};
+
+
+/// Parses and checks the parameters
+po::optional<my_params> parse_params(int argc, const char* const* argv)
+{
+    const po::optional<my_params> empty;
+    auto par = po::parse(argc, argv);
+    if (!par) {
+        std::cerr << "Usage: " << argv[0]
+                  << " file=<file_name> size=<data_size_MB_per_step> [steps=<number>] [work=<flops_per_value>]"
+                  << " [name=<dataset_name>] collective=<yes|no>"
+                  << std::endl;
+        return empty;
+    }
+
+    auto maybe_collective = par->get<bool>("collective");
+    if (!maybe_collective) {
+        std::cerr << "collective parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_file = par->get<std::string>("file");
+    if (!maybe_file) {
+        std::cerr << "file parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_size = par->get<std::size_t>("size");
+    if (!maybe_size) {
+        std::cerr << "size parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_steps = par->get_or<std::size_t>("steps", 10);
+    if (!maybe_steps) {
+        std::cerr << "steps parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_work = par->get_or<std::size_t>("work", 100);
+    if (!maybe_work) {
+        std::cerr << "work parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_name = par->get_or("name", "double_set");
+    if (!maybe_name) {
+        std::cerr << "name parameter is missing or invalid\n";
+        return empty;
+    }
+
+    if (*maybe_size<1 || *maybe_steps<1) {
+        std::cerr << "Incorrect values of parameters";
+        return empty;
+    }
+
+    const my_params my_par = {
+        *maybe_file,
+        *maybe_size,
+        *maybe_steps,
+        *maybe_work,
+        *maybe_name,
+        *maybe_collective
+    };
+    return po::make_optional(my_par);
+}
+
+
+/// A thread running one job at a time, handed over by the main thread
+class background_worker {
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::function<void()> job_;
+    bool busy_;
+    bool stop_;
+    std::thread thread_;
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            cv_.wait(lock, [this]{ return busy_ || stop_; });
+            if (!busy_) return;
+            lock.unlock();
+            job_();
+            lock.lock();
+            busy_=false;
+            cv_.notify_all();
+        }
+    }
+
+  public:
+    background_worker(): busy_(false), stop_(false), thread_(&background_worker::loop, this) {}
+
+    background_worker(const background_worker&) =delete;
+    background_worker& operator=(const background_worker&) =delete;
+
+    ~background_worker()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_=true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    /// wait for the current job to finish
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this]{ return !busy_; });
+    }
+
+    /// start a new job (after the current one is finished)
+    void submit(std::function<void()> job)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this]{ return !busy_; });
+        job_=std::move(job);
+        busy_=true;
+        cv_.notify_all();
+    }
+};
+
+
+/// Seconds elapsed since `t0`; unlike MPI_Wtime(), safe to call while the other thread is inside MPI
+inline double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+}
+
+
+/// Synthetic compute kernel: a chain of `work` multiply-adds per value
+void compute(std::vector<double>& buf, std::size_t step, std::size_t work)
+{
+    for (std::size_t i=0; i<buf.size(); ++i) {
+        double x=step+1e-6*i;
+        for (std::size_t k=0; k<work; ++k) x=x*0.999999+1e-6;
+        buf[i]=x;
+    }
+}
+
+
+int main (int argc, char **argv)
+{
+    using std::string;
+    using std::size_t;
+    using std::cerr;
+    using std::cout;
+    using std::endl;
+    typedef std::vector<double> dvec_t;
+    typedef std::chrono::steady_clock clock;
+
+    // HDF5 is called from the I/O thread, but never by two threads at once
+    mpi::environment env(argc, argv, MPI_THREAD_SERIALIZED);
+    mpi::communicator comm;
+    const int master=0;
+    bool is_master = comm.rank()==master;
+
+    const auto maybe_par = parse_and_bcast(comm, master, [&]() { return parse_params(argc, argv); });
+    if (!maybe_par) {
+        env.abort(3);
+        return 3;
+    }
+    const auto& par = *maybe_par;
+
+    if (env.thread_level()<MPI_THREAD_SERIALIZED) {
+        if (is_master) cerr << "The MPI library does not support MPI_THREAD_SERIALIZED\n";
+        env.abort(4);
+        return 4;
+    }
+
+    if (is_master) {
+        cout << std::boolalpha
+             << "Running on " << comm.size() << " processes with"
+             << " file=" << par.file_name
+             << " size=" << par.size
+             << " steps=" << par.nsteps
+             << " work=" << par.work
+             << " name=" << par.data_name
+             << " collective=" << par.do_collective
+             << std::endl;
+    }
+
+    const hsize_t nvalues=par.size*1024*1024/sizeof(double);
+
+    // Set up file access property list with parallel I/O access
+    auto plist_id = h5::plist_wrapper(H5Pcreate(H5P_FILE_ACCESS));
+    H5Pset_fapl_mpio(plist_id, comm, MPI_INFO_NULL);
+
+    // Create a new file collectively and release property list identifier.
+    auto file_id = h5::fd_wrapper(H5Fcreate(par.file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id));
+    plist_id.close();
+
+    // One row per time step, each process owns a slab of columns;
+    // the blocking and the overlapped runs write into separate datasets, both freshly allocated
+    std::array<hsize_t,2> dims={par.nsteps, nvalues*comm.size()};
+    auto filespace = h5::dspace_wrapper(H5Screate_simple(dims.size(), dims.data(), nullptr));
+    auto dset_id = h5::dset_wrapper(H5Dcreate(file_id, par.data_name.c_str(),
+                                              H5T_NATIVE_DOUBLE, filespace,
+                                              H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+    auto overlap_dset_id = h5::dset_wrapper(H5Dcreate(file_id, (par.data_name+"_overlapped").c_str(),
+                                                      H5T_NATIVE_DOUBLE, filespace,
+                                                      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+
+    std::array<hsize_t,1> mem_sz={nvalues};
+    auto memspace = h5::dspace_wrapper(H5Screate_simple(mem_sz.size(), mem_sz.data(), nullptr));
+
+    auto xfer_plist_id = h5::plist_wrapper(H5Pcreate(H5P_DATASET_XFER));
+    H5Pset_dxpl_mpio(xfer_plist_id, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT);
+
+    // Writes the step `step` from `buf` into the dataset `dset`
+    auto write_step = [&](hid_t dset, const dvec_t& buf, size_t step) {
+        std::array<hsize_t,2> offset={step, comm.rank()*nvalues};
+        std::array<hsize_t,2> count={1, nvalues};
+        h5::check_error(H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset.data(), nullptr, count.data(), nullptr));
+        h5::check_error(H5Dwrite(dset, H5T_NATIVE_DOUBLE, memspace, filespace, xfer_plist_id, buf.data()));
+    };
+
+    std::array<dvec_t,2> bufs={dvec_t(nvalues), dvec_t(nvalues)};
+
+    // 1. Computation alone
+    comm.barrier();
+    auto t0=clock::now();
+    for (size_t s=0; s<par.nsteps; ++s) compute(bufs[s%2], s, par.work);
+    const double t_compute=seconds_since(t0);
+
+    // 2. Blocking output alone
+    comm.barrier();
+    t0=clock::now();
+    for (size_t s=0; s<par.nsteps; ++s) write_step(dset_id, bufs[s%2], s);
+    const double t_io=seconds_since(t0);
+
+    // 3. Computation of step `s` overlapped with writing step `s-1`
+    double t_overlap_compute=0, t_exposed=0, t_io_thread=0;
+    comm.barrier();
+    t0=clock::now();
+    {
+        background_worker io_thread;
+        for (size_t s=0; s<par.nsteps; ++s) {
+            // the other buffer is being written as step `s-1` meanwhile;
+            // this one was written as step `s-2`, which is finished before step `s-1` is submitted
+            auto tc=clock::now();
+            compute(bufs[s%2], s, par.work);
+            t_overlap_compute+=seconds_since(tc);
+
+            auto tw=clock::now();
+            io_thread.wait();
+            t_exposed+=seconds_since(tw);
+
+            io_thread.submit([&, s]() {
+                auto ti=clock::now();
+                write_step(overlap_dset_id, bufs[s%2], s);
+                t_io_thread+=seconds_since(ti);
+            });
+        }
+        auto tw=clock::now();
+        io_thread.wait();
+        t_exposed+=seconds_since(tw);
+    }
+    const double t_overlap=seconds_since(t0);
+
+    const double r_compute=mpi::all_reduce(comm, t_compute, MPI_MAX);
+    const double r_io=mpi::all_reduce(comm, t_io, MPI_MAX);
+    const double r_overlap=mpi::all_reduce(comm, t_overlap, MPI_MAX);
+    const double r_overlap_compute=mpi::all_reduce(comm, t_overlap_compute, MPI_MAX);
+    const double r_exposed=mpi::all_reduce(comm, t_exposed, MPI_MAX);
+    const double r_io_thread=mpi::all_reduce(comm, t_io_thread, MPI_MAX);
+
+    if (is_master) {
+        const double mbytes=double(nvalues)*comm.size()*par.nsteps*sizeof(double)/(1024.*1024.);
+        // the I/O which would have been visible without the overlap is `t_io`; what is still visible is the excess
+        const double hidden=(r_compute+r_io-r_overlap)/r_io;
+        cout << std::fixed << std::setprecision(6)
+             << "compute alone: " << r_compute << " s\n"
+             << "write alone: " << r_io << " s, " << std::setprecision(2) << mbytes/r_io << " MB/s\n"
+             << std::setprecision(6)
+             << "overlapped: total=" << r_overlap << " s, compute=" << r_overlap_compute
+             << " s, write (in thread)=" << r_io_thread << " s, waiting for write=" << r_exposed << " s\n"
+             << std::setprecision(3)
+             << "I/O time hidden: " << 100*hidden << "%\n"
+             << "compute slowdown under I/O: " << r_overlap_compute/r_compute << "x"
+             << std::defaultfloat << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,315 @@
+/** @file several_proc_points.cpp Writes and reads irregular sets of elements (point selections)
+
+    Each process owns a generated set of indices into a shared 1D dataset.
+    The set is written and read back twice: once as a point selection
+    (`H5Sselect_elements`), and once packed into a union of hyperslab runs.
+ */
+
+#include <vector>
+#include <array>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <mpiwrap/mpiwrap.hpp>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "parse_and_bcast.hpp"
+#include "patterns.hpp"
+
+namespace po=program_options;
+namespace mpi=mpiwrap;
+
+struct my_params {
+    std::string file_name;
+    std::string data_name;
+    std::size_t count;
+    std::string locality;
+    std::size_t cluster_size;
+    bool is_sorted;
+    std::size_t spread;
+    unsigned long seed;
+    bool do_collective;
+
+    /// Visits the fields, to broadcast the parameters in one message
+    template <typename A>
+    void serialize(A& ar)
+    {
+        ar & file_name
+           & data_name
+           & count
+           & locality
+           & cluster_size
+           & is_sorted
+           & spread
+           & seed
+           & do_collective;
+    }
+};
+
+
+/// Parses and checks the parameters
+po::optional<my_params> parse_params(int argc, const char* const* argv)
+{
+    const po::optional<my_params> empty;
+    auto par = po::parse(argc, argv);
+    if (!par) {
+        std::cerr << "Usage: " << argv[0]
+                  << " file=<file_name> count=<elements_per_process> [locality=<random|clustered>]"
+                  << " [cluster=<elements_per_cluster>] [sorted=<yes|no>] [spread=<dataset_size_factor>]"
+                  << " [seed=<number>] [name=<dataset_name>] collective=<yes|no>"
+                  << std::endl;
+        return empty;
+    }
+
+    auto maybe_collective = par->get<bool>("collective");
+    if (!maybe_collective) {
+        std::cerr << "collective parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_file = par->get<std::string>("file");
+    if (!maybe_file) {
+        std::cerr << "file parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_count = par->get<std::size_t>("count");
+    if (!maybe_count) {
+        std::cerr << "count parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_locality = par->get_or("locality", "random");
+    if (!maybe_locality || (*maybe_locality!="random" && *maybe_locality!="clustered")) {
+        std::cerr << "locality parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_cluster = par->get_or<std::size_t>("cluster", 64);
+    if (!maybe_cluster) {
+        std::cerr << "cluster parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_sorted = par->get_or("sorted", true);
+    if (!maybe_sorted) {
+        std::cerr << "sorted parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_spread = par->get_or<std::size_t>("spread", 4);
+    if (!maybe_spread) {
+        std::cerr << "spread parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_seed = par->get_or<unsigned long>("seed", 12345);
+    if (!maybe_seed) {
+        std::cerr << "seed parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_name = par->get_or("name", "double_set");
+    if (!maybe_name) {
+        std::cerr << "name parameter is missing or invalid\n";
+        return empty;
+    }
+
+    if (*maybe_count<1 || *maybe_cluster<1 || *maybe_spread<1) {
+        std::cerr << "Incorrect values of parameters";
+        return empty;
+    }
+
+    const my_params my_par = {
+        *maybe_file,
+        *maybe_name,
+        *maybe_count,
+        *maybe_locality,
+        *maybe_locality=="clustered"? *maybe_cluster : 1,
+        *maybe_sorted,
+        *maybe_spread,
+        *maybe_seed,
+        *maybe_collective
+    };
+    return po::make_optional(my_par);
+}
+
+
+/// Generates the element indices owned by this process (see `patterns::point_indices()`)
+std::vector<hsize_t> make_indices(const my_params& par, int rank, int nprocs)
+{
+    return patterns::point_indices(par.count, par.cluster_size, par.is_sorted, par.spread, par.seed, rank, nprocs);
+}
+
+
+/// Selects a union of hyperslab runs covering the sorted `indices`; returns the number of runs
+std::size_t select_runs(hid_t space, const std::vector<hsize_t>& indices)
+{
+    std::size_t nruns=0;
+    auto op=H5S_SELECT_SET;
+    for (std::size_t i=0; i<indices.size(); ) {
+        std::size_t j=i+1;
+        while (j<indices.size() && indices[j]==indices[j-1]+1) ++j;
+
+        std::array<hsize_t,1> offset={indices[i]};
+        std::array<hsize_t,1> count={j-i};
+        h5::check_error(H5Sselect_hyperslab(space, op, offset.data(), nullptr, count.data(), nullptr));
+        op=H5S_SELECT_OR;
+        ++nruns;
+        i=j;
+    }
+    return nruns;
+}
+
+
+/// Timings of a single write/read round, maximum over processes
+struct round_times {
+    double select;
+    double write;
+    double read;
+    std::size_t errors;
+};
+
+
+int main (int argc, char **argv)
+{
+    using std::string;
+    using std::size_t;
+    using std::cerr;
+    using std::cout;
+    using std::endl;
+    typedef std::vector<double> dvec_t;
+
+    mpi::environment env(argc, argv);
+    mpi::communicator comm;
+    const int master=0;
+    bool is_master = comm.rank()==master;
+
+    const auto maybe_par = parse_and_bcast(comm, master, [&]() { return parse_params(argc, argv); });
+    if (!maybe_par) {
+        env.abort(3);
+        return 3;
+    }
+    const auto& par = *maybe_par;
+
+    if (is_master) {
+        cout << std::boolalpha
+             << "Running on " << comm.size() << " processes with"
+             << " file=" << par.file_name
+             << " count=" << par.count
+             << " locality=" << par.locality
+             << " cluster=" << par.cluster_size
+             << " sorted=" << par.is_sorted
+             << " spread=" << par.spread
+             << " seed=" << par.seed
+             << " name=" << par.data_name
+             << " collective=" << par.do_collective
+             << std::endl;
+    }
+
+    const auto indices=make_indices(par, comm.rank(), comm.size());
+    const hsize_t nclusters=(par.count+par.cluster_size-1)/par.cluster_size;
+    const hsize_t data_sz=nclusters*par.spread*comm.size()*par.cluster_size;
+
+    // Set up file access property list with parallel I/O access
+    auto plist_id = h5::plist_wrapper(H5Pcreate(H5P_FILE_ACCESS));
+    H5Pset_fapl_mpio(plist_id, comm, MPI_INFO_NULL);
+
+    // Create a new file collectively and release property list identifier.
+    auto file_id = h5::fd_wrapper(H5Fcreate(par.file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id));
+    plist_id.close();
+
+    // Create the dataspace and the dataset with default properties
+    std::array<hsize_t,1> dims={data_sz};
+    auto filespace = h5::dspace_wrapper(H5Screate_simple(dims.size(), dims.data(), nullptr));
+    auto dset_id = h5::dset_wrapper(H5Dcreate(file_id, par.data_name.c_str(),
+                                              H5T_NATIVE_DOUBLE, filespace,
+                                              H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+
+    std::array<hsize_t,1> mem_sz={indices.size()};
+    auto memspace = h5::dspace_wrapper(H5Screate_simple(mem_sz.size(), mem_sz.data(), nullptr));
+
+    auto xfer_plist_id = h5::plist_wrapper(H5Pcreate(H5P_DATASET_XFER));
+    H5Pset_dxpl_mpio(xfer_plist_id, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT);
+
+    // Writes the element `indices[i]` from `data[i]`, reads it back and compares
+    auto do_round = [&](const std::vector<hsize_t>& idx, bool as_points, std::size_t& nruns) {
+        round_times tm;
+        dvec_t data(idx.begin(), idx.end()); // each element holds its own index
+
+        comm.barrier();
+        double t0=mpi::wtime();
+        if (as_points) {
+            h5::check_error(H5Sselect_elements(filespace, H5S_SELECT_SET, idx.size(), idx.data()));
+            nruns=idx.size();
+        } else {
+            nruns=select_runs(filespace, idx);
+        }
+        tm.select=mpi::wtime()-t0;
+
+        comm.barrier();
+        t0=mpi::wtime();
+        h5::check_error(H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
+                                 xfer_plist_id, data.data()));
+        tm.write=mpi::wtime()-t0;
+
+        dvec_t rdata(idx.size());
+        comm.barrier();
+        t0=mpi::wtime();
+        h5::check_error(H5Dread(dset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
+                                xfer_plist_id, rdata.data()));
+        tm.read=mpi::wtime()-t0;
+
+        tm.errors=0;
+        for (std::size_t i=0; i<idx.size(); ++i) {
+            if (rdata[i]!=data[i]) ++tm.errors;
+        }
+
+        tm.select=mpi::all_reduce(comm, tm.select, MPI_MAX);
+        tm.write=mpi::all_reduce(comm, tm.write, MPI_MAX);
+        tm.read=mpi::all_reduce(comm, tm.read, MPI_MAX);
+        tm.errors=mpi::all_reduce(comm, tm.errors, MPI_SUM);
+        nruns=mpi::all_reduce(comm, nruns, MPI_SUM);
+        return tm;
+    };
+
+    // Point selection, in the generated order
+    std::size_t point_runs=0;
+    const round_times pt=do_round(indices, true, point_runs);
+
+    // Hyperslab runs require the elements in the file order; the packing is timed as part of the selection
+    double t0=mpi::wtime();
+    std::vector<hsize_t> sorted_indices(indices);
+    if (!par.is_sorted) std::sort(sorted_indices.begin(), sorted_indices.end());
+    const double sort_time=mpi::all_reduce(comm, mpi::wtime()-t0, MPI_MAX);
+    std::size_t slab_runs=0;
+    round_times hs=do_round(sorted_indices, false, slab_runs);
+    hs.select+=sort_time;
+
+    if (is_master) {
+        const double nelem=double(par.count)*comm.size();
+        const double mbytes=nelem*sizeof(double)/(1024.*1024.);
+        cout << "# method     elements        runs    select_s     write_s      read_s  write_MB/s   read_MB/s  write_Melem/s  errors\n";
+        for (int i=0; i<2; ++i) {
+            const round_times& tm= (i==0)? pt : hs;
+            cout << std::left << std::setw(10) << (i==0? "points" : "hyperslab") << std::right
+                 << std::setw(11) << std::size_t(nelem)
+                 << std::setw(12) << (i==0? point_runs : slab_runs)
+                 << std::fixed << std::setprecision(6)
+                 << std::setw(12) << tm.select
+                 << std::setw(12) << tm.write
+                 << std::setw(12) << tm.read
+                 << std::setprecision(2)
+                 << std::setw(12) << mbytes/tm.write
+                 << std::setw(12) << mbytes/tm.read
+                 << std::setw(15) << nelem/tm.write*1e-6
+                 << std::setw(8) << tm.errors
+                 << std::defaultfloat << endl;
+        }
+    }
+
+    return (pt.errors==0 && hs.errors==0)? 0 : 1;
+}
@@ -0,0 +1,351 @@
+/** @file several_proc_restart.cpp Writes a checkpoint by N processes and reads it back by M processes
+
+    The checkpoint consists of several 2D datasets ("variables"), each written by rows
+    as in `several_proc_rows`. It is then read back twice: by the same processes with
+    the same decomposition, and by a (possibly) different number of processes with
+    a (possibly) different decomposition, as a restarted job would do.
+ */
+
+#include <vector>
+#include <array>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <mpiwrap/mpiwrap.hpp>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "parse_and_bcast.hpp"
+
+namespace po=program_options;
+namespace mpi=mpiwrap;
+
+struct my_params {
+    std::string file_name;
+    std::size_t nrows;
+    std::size_t ncols;
+    std::size_t nvars;
+    int nwriters;
+    int nreaders;
+    std::string decomposition;
+    std::string data_name;
+    bool do_collective;
+
+    /// Visits the fields, to broadcast the parameters in one message
+    template <typename A>
+    void serialize(A& ar)
+    {
+        ar & file_name
+           & nrows
+           & ncols
+           & nvars
+           & nwriters
+           & nreaders
+           & decomposition
+           & data_name
+           & do_collective;
+    }
+};
+
+
+/// Parses and checks the parameters
+po::optional<my_params> parse_params(int argc, const char* const* argv, int nprocs)
+{
+    const po::optional<my_params> empty;
+    auto par = po::parse(argc, argv);
+    if (!par) {
+        std::cerr << "Usage: " << argv[0]
+                  << " file=<file_name> rows=<number> cols=<number> [vars=<number_of_datasets>]"
+                  << " [writers=<N>] [readers=<M>] [decomp=<rows|cols|blocks>]"
+                  << " [name=<dataset_name_prefix>] collective=<yes|no>"
+                  << std::endl;
+        return empty;
+    }
+
+    auto maybe_collective = par->get<bool>("collective");
+    if (!maybe_collective) {
+        std::cerr << "collective parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_file = par->get<std::string>("file");
+    if (!maybe_file) {
+        std::cerr << "file parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_rows = par->get<std::size_t>("rows");
+    if (!maybe_rows) {
+        std::cerr << "rows parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_cols = par->get<std::size_t>("cols");
+    if (!maybe_cols) {
+        std::cerr << "cols parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_vars = par->get_or<std::size_t>("vars", 4);
+    if (!maybe_vars) {
+        std::cerr << "vars parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_writers = par->get_or("writers", nprocs);
+    if (!maybe_writers) {
+        std::cerr << "writers parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_readers = par->get_or("readers", nprocs);
+    if (!maybe_readers) {
+        std::cerr << "readers parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_decomp = par->get_or("decomp", "cols");
+    if (!maybe_decomp || (*maybe_decomp!="rows" && *maybe_decomp!="cols" && *maybe_decomp!="blocks")) {
+        std::cerr << "decomp parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_name = par->get_or("name", "var");
+    if (!maybe_name) {
+        std::cerr << "name parameter is missing or invalid\n";
+        return empty;
+    }
+
+    if (*maybe_vars<1 || *maybe_writers<1 || *maybe_writers>nprocs
+        || *maybe_readers<1 || *maybe_readers>nprocs) {
+        std::cerr << "Incorrect values of parameters";
+        return empty;
+    }
+
+    const my_params my_par = {
+        *maybe_file,
+        *maybe_rows,
+        *maybe_cols,
+        *maybe_vars,
+        *maybe_writers,
+        *maybe_readers,
+        *maybe_decomp,
+        *maybe_name,
+        *maybe_collective
+    };
+    return po::make_optional(my_par);
+}
+
+
+/// Piece of a 2D array owned by one process
+struct slab {
+    std::array<hsize_t,2> offset;
+    std::array<hsize_t,2> count;
+};
+
+
+/// Offset of part `i` when `n` items are split into `nparts` nearly equal parts
+inline hsize_t part_start(hsize_t n, hsize_t nparts, hsize_t i)
+{
+    return i*(n/nparts) + std::min(i, n%nparts);
+}
+
+
+/// The piece of the `nrows` x `ncols` array owned by `rank` out of `nprocs` under the decomposition `decomp`
+slab decompose(const std::string& decomp, hsize_t nrows, hsize_t ncols, int rank, int nprocs)
+{
+    std::array<int,2> grid={nprocs, 1};
+    if (decomp=="cols") {
+        grid={1, nprocs};
+    } else if (decomp=="blocks") {
+        grid={0, 0};
+        MPI_Dims_create(nprocs, 2, grid.data());
+    }
+    const hsize_t gi=rank/grid[1], gj=rank%grid[1];
+    const hsize_t r0=part_start(nrows, grid[0], gi), r1=part_start(nrows, grid[0], gi+1);
+    const hsize_t c0=part_start(ncols, grid[1], gj), c1=part_start(ncols, grid[1], gj+1);
+    return slab{ {{r0, c0}}, {{r1-r0, c1-c0}} };
+}
+
+
+/// Value of element (i,j) of the variable `var`
+inline double pattern(std::size_t var, hsize_t i, hsize_t j, hsize_t ncols)
+{
+    return double(i*ncols+j) + 0.25*var;
+}
+
+
+/// Creates or opens the checkpoint file on the given communicator
+hid_t open_checkpoint(const my_params& par, const mpi::communicator& comm, bool create)
+{
+    auto plist_id = h5::plist_wrapper(H5Pcreate(H5P_FILE_ACCESS));
+    H5Pset_fapl_mpio(plist_id, comm, MPI_INFO_NULL);
+    if (create) return H5Fcreate(par.file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id);
+    return H5Fopen(par.file_name.c_str(), H5F_ACC_RDONLY, plist_id);
+}
+
+
+/// Reads all variables of the checkpoint under the given decomposition; returns the time and the number of wrong values
+std::pair<double,std::size_t> read_checkpoint(const my_params& par, const mpi::communicator& comm,
+                                              const std::string& decomp)
+{
+    auto file_id = h5::fd_wrapper(open_checkpoint(par, comm, false));
+    const slab my_slab=decompose(decomp, par.nrows, par.ncols, comm.rank(), comm.size());
+    auto memspace = h5::dspace_wrapper(H5Screate_simple(my_slab.count.size(), my_slab.count.data(), nullptr));
+
+    auto xfer_plist_id = h5::plist_wrapper(H5Pcreate(H5P_DATASET_XFER));
+    H5Pset_dxpl_mpio(xfer_plist_id, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT);
+
+    std::vector<std::vector<double>> data(par.nvars, std::vector<double>(my_slab.count[0]*my_slab.count[1]));
+
+    comm.barrier();
+    const double t0=mpi::wtime();
+    for (std::size_t v=0; v<par.nvars; ++v) {
+        const std::string dname=par.data_name+std::to_string(v);
+        auto dset_id = h5::dset_wrapper(H5Dopen(file_id, dname.c_str(), H5P_DEFAULT));
+        auto filespace = h5::dspace_wrapper(H5Dget_space(dset_id));
+        h5::check_error(H5Sselect_hyperslab(filespace, H5S_SELECT_SET, my_slab.offset.data(), nullptr,
+                                            my_slab.count.data(), nullptr));
+        h5::check_error(H5Dread(dset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
+                                xfer_plist_id, data[v].data()));
+    }
+    const double elapsed=mpi::wtime()-t0;
+
+    std::size_t nbad=0;
+    for (std::size_t v=0; v<par.nvars; ++v) {
+        for (hsize_t i=0; i<my_slab.count[0]; ++i) {
+            for (hsize_t j=0; j<my_slab.count[1]; ++j) {
+                const double expected=pattern(v, my_slab.offset[0]+i, my_slab.offset[1]+j, par.ncols);
+                if (data[v][i*my_slab.count[1]+j]!=expected) ++nbad;
+            }
+        }
+    }
+    return std::make_pair(mpi::all_reduce(comm, elapsed, MPI_MAX),
+                          mpi::all_reduce(comm, nbad, MPI_SUM));
+}
+
+
+int main (int argc, char **argv)
+{
+    using std::string;
+    using std::size_t;
+    using std::cerr;
+    using std::cout;
+    using std::endl;
+    typedef std::vector<double> dvec_t;
+
+    mpi::environment env(argc, argv);
+    mpi::communicator comm;
+    const int master=0;
+    bool is_master = comm.rank()==master;
+
+    const auto maybe_par = parse_and_bcast(comm, master, [&]() { return parse_params(argc, argv, comm.size()); });
+    if (!maybe_par) {
+        env.abort(3);
+        return 3;
+    }
+    const auto& par = *maybe_par;
+
+    if (is_master) {
+        cout << std::boolalpha
+             << "Running on " << comm.size() << " processes with"
+             << " file=" << par.file_name
+             << " (rows,cols)=(" << par.nrows << ", " << par.ncols << ")"
+             << " vars=" << par.nvars
+             << " writers=" << par.nwriters
+             << " readers=" << par.nreaders
+             << " decomp=" << par.decomposition
+             << " name=" << par.data_name
+             << " collective=" << par.do_collective
+             << std::endl;
+    }
+
+    // The writing and the restarted jobs run on the first N and the first M processes, respectively
+    const bool is_writer=comm.rank()<par.nwriters;
+    const bool is_reader=comm.rank()<par.nreaders;
+    const auto writers=comm.split(is_writer? 0 : MPI_UNDEFINED, comm.rank());
+    const auto readers=comm.split(is_reader? 0 : MPI_UNDEFINED, comm.rank());
+
+    double t_write=0, t_same=0, t_restart=0;
+    size_t bad_same=0, bad_restart=0;
+
+    if (is_writer) {
+        auto file_id = h5::fd_wrapper(open_checkpoint(par, writers, true));
+
+        std::array<hsize_t,2> dims={par.nrows, par.ncols};
+        auto filespace = h5::dspace_wrapper(H5Screate_simple(dims.size(), dims.data(), nullptr));
+
+        const slab my_slab=decompose("rows", par.nrows, par.ncols, writers.rank(), writers.size());
+        auto memspace = h5::dspace_wrapper(H5Screate_simple(my_slab.count.size(), my_slab.count.data(), nullptr));
+        h5::check_error(H5Sselect_hyperslab(filespace, H5S_SELECT_SET, my_slab.offset.data(), nullptr,
+                                            my_slab.count.data(), nullptr));
+
+        std::vector<dvec_t> data(par.nvars, dvec_t(my_slab.count[0]*my_slab.count[1]));
+        for (size_t v=0; v<par.nvars; ++v) {
+            for (hsize_t i=0; i<my_slab.count[0]; ++i) {
+                for (hsize_t j=0; j<my_slab.count[1]; ++j) {
+                    data[v][i*my_slab.count[1]+j]=pattern(v, my_slab.offset[0]+i, j, par.ncols);
+                }
+            }
+        }
+
+        auto xfer_plist_id = h5::plist_wrapper(H5Pcreate(H5P_DATASET_XFER));
+        H5Pset_dxpl_mpio(xfer_plist_id, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT);
+
+        writers.barrier();
+        const double t0=mpi::wtime();
+        for (size_t v=0; v<par.nvars; ++v) {
+            const string dname=par.data_name+std::to_string(v);
+            auto dset_id = h5::dset_wrapper(H5Dcreate(file_id, dname.c_str(),
+                                                      H5T_NATIVE_DOUBLE, filespace,
+                                                      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+            h5::check_error(H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
+                                     xfer_plist_id, data[v].data()));
+        }
+        file_id.close();
+        t_write=mpi::all_reduce(writers, mpi::wtime()-t0, MPI_MAX);
+    }
+    comm.barrier();
+
+    // Baseline: the writing job reads its own decomposition back
+    if (is_writer) {
+        const auto res=read_checkpoint(par, writers, "rows");
+        t_same=res.first;
+        bad_same=res.second;
+    }
+    comm.barrier();
+
+    // Restart: M processes read with their own decomposition
+    if (is_reader) {
+        const auto res=read_checkpoint(par, readers, par.decomposition);
+        t_restart=res.first;
+        bad_restart=res.second;
+    }
+
+    if (is_master) {
+        const double mbytes=double(par.nrows)*par.ncols*par.nvars*sizeof(double)/(1024.*1024.);
+        cout << std::fixed
+             << "# phase      procs decomp        time_s        MB/s  errors\n";
+        const struct { const char* phase; int procs; const char* decomp; double t; size_t bad; } rows[]={
+            { "write",   par.nwriters, "rows",                   t_write,   0 },
+            { "read",    par.nwriters, "rows",                   t_same,    bad_same },
+            { "restart", par.nreaders, par.decomposition.c_str(), t_restart, bad_restart }
+        };
+        for (const auto& r: rows) {
+            cout << std::left << std::setw(10) << r.phase << std::right
+                 << std::setw(8) << r.procs << " "
+                 << std::left << std::setw(8) << r.decomp << std::right
+                 << std::setprecision(6) << std::setw(14) << r.t
+                 << std::setprecision(2) << std::setw(12) << mbytes/r.t
+                 << std::setw(8) << r.bad << "\n";
+        }
+        cout << std::setprecision(6)
+             << "redistribution overhead: " << (t_restart-t_same) << " s ("
+             << std::setprecision(3) << t_restart/t_same << "x the same-decomposition read)"
+             << std::defaultfloat << endl;
+    }
+
+    return (bad_same==0 && bad_restart==0)? 0 : 1;
+}
@@ -0,0 +1,265 @@
+/** @file several_proc_varsize.cpp Writes variable amounts of data per process into one dataset
+
+    The number of values written by each process is drawn from a distribution;
+    the offsets into the shared 1D dataset are computed by a prefix sum over the processes.
+ */
+
+#include <vector>
+#include <array>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+
+#include <mpiwrap/mpiwrap.hpp>
+#include <cmdline/cmdline.hpp>
+
+#include "h5_cxx_interface.hpp"
+#include "parse_and_bcast.hpp"
+
+namespace po=program_options;
+namespace mpi=mpiwrap;
+
+struct my_params {
+    std::string file_name;
+    std::string data_name;
+    std::size_t mean_count;
+    std::string distribution;
+    double width;
+    double hot_factor;
+    int hot_rank;
+    unsigned long seed;
+    bool do_collective;
+
+    /// Visits the fields, to broadcast the parameters in one message
+    template <typename A>
+    void serialize(A& ar)
+    {
+        ar & file_name
+           & data_name
+           & mean_count
+           & distribution
+           & width
+           & hot_factor
+           & hot_rank
+           & seed
+           & do_collective;
+    }
+};
+
+
+/// Parses and checks the parameters
+po::optional<my_params> parse_params(int argc, const char* const* argv, int nprocs)
+{
+    const po::optional<my_params> empty;
+    auto par = po::parse(argc, argv);
+    if (!par) {
+        std::cerr << "Usage: " << argv[0]
+                  << " file=<file_name> count=<mean_values_per_process> [dist=<uniform|lognormal|hot>]"
+                  << " [width=<uniform_rel_halfwidth|lognormal_sigma>] [hot=<hot_rank_factor>] [hotrank=<rank>]"
+                  << " [seed=<number>] [name=<dataset_name>] collective=<yes|no>"
+                  << std::endl;
+        return empty;
+    }
+
+    auto maybe_collective = par->get<bool>("collective");
+    if (!maybe_collective) {
+        std::cerr << "collective parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_file = par->get<std::string>("file");
+    if (!maybe_file) {
+        std::cerr << "file parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_count = par->get<std::size_t>("count");
+    if (!maybe_count || *maybe_count<1) {
+        std::cerr << "count parameter is missing or invalid\n";
+        return empty;
+    }
+
+    auto maybe_dist = par->get_or("dist", "uniform");
+    if (!maybe_dist || (*maybe_dist!="uniform" && *maybe_dist!="lognormal" && *maybe_dist!="hot")) {
+        std::cerr << "dist parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_width = par->get_or("width", 0.5);
+    if (!maybe_width) {
+        std::cerr << "width parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_hot = par->get_or("hot", 10.0);
+    if (!maybe_hot) {
+        std::cerr << "hot parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_hotrank = par->get_or("hotrank", 0);
+    if (!maybe_hotrank) {
+        std::cerr << "hotrank parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_seed = par->get_or<unsigned long>("seed", 12345);
+    if (!maybe_seed) {
+        std::cerr << "seed parameter is invalid\n";
+        return empty;
+    }
+
+    auto maybe_name = par->get_or("name", "double_set");
+    if (!maybe_name) {
+        std::cerr << "name parameter is missing or invalid\n";
+        return empty;
+    }
+
+    if (*maybe_width<0 || (*maybe_dist=="uniform" && *maybe_width>1) || *maybe_hot<0
+        || *maybe_hotrank<0 || *maybe_hotrank>=nprocs) {
+        std::cerr << "Incorrect values of parameters";
+        return empty;
+    }
+
+    const my_params my_par = {
+        *maybe_file,
+        *maybe_name,
+        *maybe_count,
+        *maybe_dist,
+        *maybe_width,
+        *maybe_hot,
+        *maybe_hotrank,
+        *maybe_seed,
+        *maybe_collective
+    };
+    return po::make_optional(my_par);
+}
+
+
+/// Draws the number of values this process writes
+std::size_t draw_count(const my_params& par, int rank)
+{
+    const double mean=par.mean_count;
+    std::mt19937_64 rng(par.seed+rank);
+    double n=mean;
+    if (par.distribution=="uniform") {
+        std::uniform_real_distribution<double> dist(mean*(1-par.width), mean*(1+par.width));
+        n=dist(rng);
+    } else if (par.distribution=="lognormal") {
+        // mu is chosen so that the distribution mean is `mean`
+        const double sigma=par.width;
+        std::lognormal_distribution<double> dist(std::log(mean)-0.5*sigma*sigma, sigma);
+        n=dist(rng);
+    } else if (par.distribution=="hot") {
+        if (rank==par.hot_rank) n=mean*par.hot_factor;
+    }
+    return std::size_t(std::llround(n));
+}
+
+
+int main (int argc, char **argv)
+{
+    using std::string;
+    using std::size_t;
+    using std::cerr;
+    using std::cout;
+    using std::endl;
+    typedef std::vector<double> dvec_t;
+
+    mpi::environment env(argc, argv);
+    mpi::communicator comm;
+    const int master=0;
+    bool is_master = comm.rank()==master;
+
+    const auto maybe_par = parse_and_bcast(comm, master, [&]() { return parse_params(argc, argv, comm.size()); });
+    if (!maybe_par) {
+        env.abort(3);
+        return 3;
+    }
+    const auto& par = *maybe_par;
+
+    if (is_master) {
+        cout << std::boolalpha
+             << "Running on " << comm.size() << " processes with"
+             << " file=" << par.file_name
+             << " count=" << par.mean_count
+             << " dist=" << par.distribution
+             << " width=" << par.width
+             << " hot=" << par.hot_factor
+             << " hotrank=" << par.hot_rank
+             << " seed=" << par.seed
+             << " name=" << par.data_name
+             << " collective=" << par.do_collective
+             << std::endl;
+    }
+
+    // Each process finds its own size, its offset and the total size
+    const size_t my_count=draw_count(par, comm.rank());
+    const size_t my_offset=mpi::exscan(comm, my_count, MPI_SUM);
+    const size_t total=mpi::all_reduce(comm, my_count, MPI_SUM);
+
+    // Set up file access property list with parallel I/O access
+    auto plist_id = h5::plist_wrapper(H5Pcreate(H5P_FILE_ACCESS));
+    H5Pset_fapl_mpio(plist_id, comm, MPI_INFO_NULL);
+
+    // Create a new file collectively and release property list identifier.
+    auto file_id = h5::fd_wrapper(H5Fcreate(par.file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id));
+    plist_id.close();
+
+    // Create the dataspace and the dataset with default properties
+    std::array<hsize_t,1> dims={total};
+    auto filespace = h5::dspace_wrapper(H5Screate_simple(dims.size(), dims.data(), nullptr));
+    auto dset_id = h5::dset_wrapper(H5Dcreate(file_id, par.data_name.c_str(),
+                                              H5T_NATIVE_DOUBLE, filespace,
+                                              H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+
+    // Each process selects its own contiguous piece; an empty piece still takes part in the collective write
+    std::array<hsize_t,1> offset={my_offset};
+    std::array<hsize_t,1> count={my_count};
+    auto memspace = h5::dspace_wrapper(H5Screate_simple(count.size(), count.data(), nullptr));
+    if (my_count>0) {
+        h5::check_error(H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset.data(), nullptr, count.data(), nullptr));
+    } else {
+        h5::check_error(H5Sselect_none(filespace));
+        h5::check_error(H5Sselect_none(memspace));
+    }
+
+    // Initialize data buffer: each value holds its index in the dataset
+    dvec_t data(my_count);
+    for (size_t i=0; i<my_count; ++i) data[i]=my_offset+i;
+
+    auto xfer_plist_id = h5::plist_wrapper(H5Pcreate(H5P_DATASET_XFER));
+    H5Pset_dxpl_mpio(xfer_plist_id, par.do_collective? H5FD_MPIO_COLLECTIVE:H5FD_MPIO_INDEPENDENT);
+
+    // Write the data: the time of each process is from the common start to its own completion
+    comm.barrier();
+    const double t0=mpi::wtime();
+    h5::check_error(
+        H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
+                 xfer_plist_id, data.data()) );
+    const double my_time=mpi::wtime()-t0;
+
+    const double t_min=mpi::all_reduce(comm, my_time, MPI_MIN);
+    const double t_max=mpi::all_reduce(comm, my_time, MPI_MAX);
+    const double t_mean=mpi::all_reduce(comm, my_time, MPI_SUM)/comm.size();
+    const size_t n_min=mpi::all_reduce(comm, my_count, MPI_MIN);
+    const size_t n_max=mpi::all_reduce(comm, my_count, MPI_MAX);
+
+    if (is_master) {
+        const double mbytes=double(total)*sizeof(double)/(1024.*1024.);
+        const double imbalance= (total>0)? n_max/(double(total)/comm.size()) : 0;
+        cout << std::fixed << std::setprecision(6)
+             << "values: total=" << total << " min=" << n_min << " max=" << n_max
+             << " max/mean=" << std::setprecision(3) << imbalance << "\n"
+             << std::setprecision(6)
+             << "write time, s: min=" << t_min << " mean=" << t_mean << " max=" << t_max
+             << " spread=" << (t_max-t_min) << "\n"
+             << std::setprecision(2)
+             << "aggregate bandwidth, MB/s: " << mbytes/t_max
+             << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/** @file slabs.hpp
+    Regular hyperslabs and block decompositions of N-dimensional arrays, with the rank known at compile time
+*/
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <algorithm>
+
+#include <mpi.h>
+#include <hdf5.h>
+
+#include "h5_cxx_interface.hpp"
+
+namespace slabs {
+
+    /// The highest rank for which `dispatch_rank()` instantiates the templates
+    const std::size_t max_rank=8;
+
+    /// A regular hyperslab of a rank-`N` array, as for `H5Sselect_hyperslab()`
+    /**
+       The extents live in fixed-size arrays, so selecting the hyperslab allocates nothing.
+    */
+    template <std::size_t N>
+    struct slab {
+        typedef std::array<hsize_t,N> extents;
+        extents start, stride, count, block;
+
+        /// A single block of extents `shape` at `offset`
+        static slab box(const extents& offset, const extents& shape)
+        {
+            slab s;
+            s.start=offset;
+            s.stride.fill(1);
+            s.count.fill(1);
+            s.block=shape;
+            return s;
+        }
+
+        /// number of the selected elements
+        hsize_t size() const
+        {
+            hsize_t n=1;
+            for (std::size_t d=0; d<N; ++d) n*=count[d]*block[d];
+            return n;
+        }
+
+        /// Selects the elements in `space`, whose rank must be `N`
+        void apply(hid_t space, H5S_seloper_t op=H5S_SELECT_SET) const
+        {
+            if (size()==0) {
+                if (op==H5S_SELECT_SET) h5::check_error(H5Sselect_none(space));
+                return;
+            }
+            h5::check_error(H5Sselect_hyperslab(space, op, start.data(), stride.data(), count.data(), block.data()));
+        }
+    };
+
+
+    /// Offset of part `i` when `n` items are split into `nparts` nearly equal parts
+    inline hsize_t part_start(hsize_t n, hsize_t nparts, hsize_t i)
+    {
+        return i*(n/nparts) + std::min(i, n%nparts);
+    }
+
+
+    /// A rank-`N` array of extents `dims`, split into blocks over a `grid` of processes
+    /**
+       The processes are placed on the grid in the row-major order (as `MPI_Cart_create()` does).
+       If `cyclic[d]` is 0, the extent of the dimension `d` is split between the processes along
+       it as evenly as possible; otherwise it is dealt out to them round-robin in blocks of
+       `cyclic[d]` (a block-cyclic distribution, as in ScaLAPACK), and must be a multiple of
+       `grid[d]*cyclic[d]`. Each process keeps its part in a local array with `ghost[d]` cells on
+       both sides of the dimension `d`, of which only the interior is transferred.
+    */
+    template <std::size_t N>
+    class decomposition {
+      public:
+        typedef typename slab<N>::extents extents;
+
+      private:
+        extents dims_, grid_, ghost_, cyclic_;
+
+      public:
+        decomposition(const extents& dims, const extents& grid, const extents& ghost, const extents& cyclic)
+            : dims_(dims), grid_(grid), ghost_(ghost), cyclic_(cyclic) {}
+
+        const extents& dims() const { return dims_; }
+        const extents& grid() const { return grid_; }
+        const extents& ghost() const { return ghost_; }
+        const extents& cyclic() const { return cyclic_; }
+
+        /// the number of processes on the grid
+        hsize_t nprocs() const
+        {
+            hsize_t n=1;
+            for (auto g: grid_) n*=g;
+            return n;
+        }
+
+        /// the coordinates of the process `rank` on the grid
+        extents coords(hsize_t rank) const
+        {
+            extents c;
+            for (std::size_t d=N; d>0; --d) {
+                c[d-1]=rank%grid_[d-1];
+                rank/=grid_[d-1];
+            }
+            return c;
+        }
+
+        /// the part of the process `rank` in the array; empty for the processes beyond the grid
+        slab<N> file_slab(hsize_t rank) const
+        {
+            extents zeros;
+            zeros.fill(0);
+            slab<N> s=slab<N>::box(zeros, zeros);
+            if (rank>=nprocs()) return s;
+            const extents c=coords(rank);
+            for (std::size_t d=0; d<N; ++d) {
+                if (cyclic_[d]==0) {
+                    s.start[d]=part_start(dims_[d], grid_[d], c[d]);
+                    s.block[d]=part_start(dims_[d], grid_[d], c[d]+1)-s.start[d];
+                } else {
+                    s.start[d]=c[d]*cyclic_[d];
+                    s.stride[d]=grid_[d]*cyclic_[d];
+                    s.count[d]=dims_[d]/s.stride[d];
+                    s.block[d]=cyclic_[d];
+                }
+            }
+            return s;
+        }
+
+        /// the extents of the interior of the local array of the process `rank`, i.e., of its part of the array
+        extents interior(hsize_t rank) const
+        {
+            const slab<N> s=file_slab(rank);
+            extents n;
+            for (std::size_t d=0; d<N; ++d) n[d]=s.count[d]*s.block[d];
+            return n;
+        }
+
+        /// the extents of the local array of the process `rank`, ghost cells included
+        extents local_dims(hsize_t rank) const
+        {
+            extents local=interior(rank);
+            for (std::size_t d=0; d<N; ++d) local[d]+=2*ghost_[d];
+            return local;
+        }
+
+        /// the interior of the local array of the process `rank`, which is transferred to or from its part
+        slab<N> memory_slab(hsize_t rank) const
+        {
+            return slab<N>::box(ghost_, interior(rank));
+        }
+    };
+
+
+    namespace detail {
+        template <std::size_t N>
+        struct rank_dispatcher {
+            template <typename F>
+            static bool run(std::size_t n, F& f)
+            {
+                if (n==N) {
+                    f.template run<N>();
+                    return true;
+                }
+                return rank_dispatcher<N-1>::run(n, f);
+            }
+        };
+
+        template <>
+        struct rank_dispatcher<0> {
+            template <typename F>
+            static bool run(std::size_t, F&) { return false; }
+        };
+    }
+
+    /// Calls `f.template run<N>()` for the rank `n` known at run time; false if `n` is 0 or above `max_rank`
+    template <typename F>
+    inline bool dispatch_rank(std::size_t n, F& f)
+    {
+        return detail::rank_dispatcher<max_rank>::run(n, f);
+    }
+}
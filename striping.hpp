@@ -0,0 +1,150 @@
+/** @file striping.hpp
+    A stand-in for a striped file system: the bytes each storage target would receive, as on Lustre
+*/
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <mpi.h>
+#include <mpiwrap/mpiwrap.hpp>
+
+#include "results.hpp"
+
+namespace striping {
+
+    /// The bytes written to each target of a file striped round-robin over `count` targets in stripes of `stripe` bytes
+    /**
+       The stripe `k` of the file lives on the target `k % count`, as with the default
+       Lustre layout. The accesses that cross a stripe boundary are counted too: each
+       of them is split between two targets (and, on Lustre, between two lock extents).
+    */
+    class balance {
+        std::uint64_t stripe_;
+        std::vector<double> bytes_;
+        double accesses_=0, straddling_=0;
+
+      public:
+        balance(std::uint64_t stripe, std::size_t count): stripe_(stripe), bytes_(count, 0.) {}
+
+        /// Adds an access of `length` bytes at the file offset `offset`
+        void add(std::uint64_t offset, std::uint64_t length)
+        {
+            if (length==0) return;
+            ++accesses_;
+            if (offset/stripe_!=(offset+length-1)/stripe_) ++straddling_;
+
+            const std::uint64_t count=bytes_.size();
+            const std::uint64_t cycle=stripe_*count;
+            while (length>0) {
+                if (offset%cycle==0 && length>=cycle) {
+                    // whole cycles give each target a stripe
+                    const std::uint64_t ncycles=length/cycle;
+                    for (auto& b: bytes_) b+=double(ncycles*stripe_);
+                    offset+=ncycles*cycle;
+                    length-=ncycles*cycle;
+                    continue;
+                }
+                const std::uint64_t n=std::min(length, stripe_-offset%stripe_);
+                bytes_[(offset/stripe_)%count]+=n;
+                offset+=n;
+                length-=n;
+            }
+        }
+
+        /// Sums the counts of all processes
+        void reduce(const mpiwrap::communicator& comm)
+        {
+            MPI_Allreduce(MPI_IN_PLACE, bytes_.data(), bytes_.size(), MPI_DOUBLE, MPI_SUM, comm);
+            MPI_Allreduce(MPI_IN_PLACE, &accesses_, 1, MPI_DOUBLE, MPI_SUM, comm);
+            MPI_Allreduce(MPI_IN_PLACE, &straddling_, 1, MPI_DOUBLE, MPI_SUM, comm);
+        }
+
+        /// whether there are targets, i.e., whether the balance is simulated
+        bool simulated() const { return !bytes_.empty(); }
+
+        // the values are negative if the balance is not simulated
+        double min_mb() const { return simulated()? *std::min_element(bytes_.begin(), bytes_.end())/(1024.*1024.) : -1.; }
+        double max_mb() const { return simulated()? *std::max_element(bytes_.begin(), bytes_.end())/(1024.*1024.) : -1.; }
+
+        double mean_mb() const
+        {
+            if (!simulated()) return -1.;
+            double sum=0;
+            for (auto b: bytes_) sum+=b;
+            return sum/bytes_.size()/(1024.*1024.);
+        }
+
+        /// the busiest target over the mean: 1 if the targets are balanced
+        double imbalance() const
+        {
+            if (!simulated()) return -1.;
+            return mean_mb()>0? max_mb()/mean_mb() : 1.;
+        }
+
+        /// Prints the balance, with one line per target if there are few
+        void print(std::ostream& os) const
+        {
+            os << std::fixed << std::setprecision(2)
+               << "targets (simulated " << bytes_.size() << " x " << stripe_ << " B stripes): MB per target min/mean/max "
+               << min_mb() << "/" << mean_mb() << "/" << max_mb() << ", imbalance " << imbalance()
+               << ", accesses crossing a stripe boundary " << std::setprecision(0) << straddling_ << " of " << accesses_
+               << "\n";
+            if (bytes_.size()<=16) {
+                os << std::setprecision(2);
+                for (std::size_t t=0; t<bytes_.size(); ++t) os << "  target " << t << ": " << bytes_[t]/(1024.*1024.) << " MB\n";
+            }
+            os << std::defaultfloat;
+            os.flush();
+        }
+
+        void add_to(results::record& rec) const
+        {
+            rec.add("target_MB_min", min_mb())
+               .add("target_MB_mean", mean_mb())
+               .add("target_MB_max", max_mb())
+               .add("target_imbalance", imbalance())
+               .add("accesses", simulated()? accesses_ : -1.)
+               .add("straddling_accesses", simulated()? straddling_ : -1.);
+        }
+    };
+
+
+    /// The alignment of a benchmark point to stripes, and the simulated balance over the targets
+    struct report {
+        std::uint64_t stripe=0;       ///< 0 if the stripes are unknown
+        bool aligned=false;           ///< whether the accesses are aligned to the stripes
+        std::size_t count=0;          ///< the number of targets to simulate
+        double padding_mb=0;          ///< the padding added to the datasets by the pattern
+        double data_mb=0;             ///< the datasets, padding included
+        double file_mb=-1;            ///< the size of the file; negative if unknown
+        balance targets{1, 0};        ///< no targets if the balance is not simulated
+
+        void print(std::ostream& os) const
+        {
+            if (stripe==0) return;
+            os << std::fixed << std::setprecision(2)
+               << "stripes: " << stripe << " B, " << (aligned? "aligned" : "not aligned") << ", padding " << padding_mb << " MB of " << data_mb << " MB of datasets ("
+               << (data_mb>0? 100*padding_mb/data_mb : 0.) << "%)";
+            if (file_mb>=0) os << ", file " << file_mb << " MB";
+            os << std::defaultfloat << "\n";
+            if (targets.simulated()) {
+                targets.print(os);
+            } else if (count>0) {
+                os << "targets: not simulated, as the file offsets of chunked datasets are not linear\n";
+            }
+            os.flush();
+        }
+
+        void add_to(results::record& rec) const
+        {
+            rec.add("stripe_padding_MB", padding_mb)
+               .add("file_MB", file_mb);
+            targets.add_to(rec);
+        }
+    };
+}
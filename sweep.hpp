@@ -0,0 +1,79 @@
+/** @file sweep.hpp
+    Helpers to run a benchmark over all points of a parameter sweep within one job
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+#include <iomanip>
+
+#include <cmdline/cmdline.hpp>
+
+namespace sweep {
+
+    /// Timings of one sweep point, reduced over the processes
+    struct point_result {
+        std::string label;       ///< values of the swept parameters
+        double prepare_time;
+        double write_time;
+        double write_mbytes;
+        std::string write_mode;  ///< I/O mode actually used by HDF5 (as seen by rank 0)
+        double read_time;        ///< zero if the data were not read back
+        double read_mbytes;
+        std::string read_mode;
+    };
+
+    /// The parameters whose values are names, taken verbatim rather than split into sweep points
+    inline const std::vector<std::string>& verbatim_keys()
+    {
+        static const std::vector<std::string> keys={"file", "name", "hints", "results", "trace", "record", "tmpdir"};
+        return keys;
+    }
+
+    /// The values of the swept parameters `keys` at the sweep point `point`, as `key=value` pairs
+    inline std::string point_label(const program_options::params_map& point, const std::vector<std::string>& keys)
+    {
+        std::string label;
+        for (const auto& key: keys) {
+            if (!label.empty()) label+=" ";
+            label+=key+"="+*point.get<std::string>(key);
+        }
+        return label;
+    }
+
+    /// The file name for the sweep point `index`: the index is inserted before the extension
+    inline std::string point_file_name(const std::string& name, std::size_t index)
+    {
+        const auto dot=name.rfind('.');
+        const auto slash=name.rfind('/');
+        const bool has_ext= dot!=std::string::npos && dot>0 && (slash==std::string::npos || dot>slash+1);
+        const std::string suffix="."+std::to_string(index);
+        return has_ext? name.substr(0, dot)+suffix+name.substr(dot) : name+suffix;
+    }
+
+    /// Prints one row per sweep point; `read_name` names the read phase of the benchmark
+    inline void print_table(std::ostream& os, const std::vector<point_result>& results, const std::string& read_name)
+    {
+        os << "sweep results (" << results.size() << " points):\n"
+           << std::setw(6) << "point"
+           << std::setw(12) << "write_s" << std::setw(12) << "write_MB/s"
+           << std::setw(12) << read_name+"_s" << std::setw(12) << read_name+"_MB/s"
+           << "  parameters\n";
+        for (std::size_t i=0; i<results.size(); ++i) {
+            const auto& res=results[i];
+            os << std::setw(6) << i << std::fixed
+               << std::setw(12) << std::setprecision(6) << res.write_time
+               << std::setw(12) << std::setprecision(2) << res.write_mbytes/res.write_time;
+            if (res.read_time>0) {
+                os << std::setw(12) << std::setprecision(6) << res.read_time
+                   << std::setw(12) << std::setprecision(2) << res.read_mbytes/res.read_time;
+            } else {
+                os << std::setw(12) << "-" << std::setw(12) << "-";
+            }
+            os << std::defaultfloat << "  " << res.label << "\n";
+        }
+        os.flush();
+    }
+}